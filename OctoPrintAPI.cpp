@@ -10,6 +10,19 @@
 #include "OctoPrintAPI.h"
 
 #include "Arduino.h"
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+
+/** octoprintHostByName()
+ * The core's DNS client as an OctoprintResolver, for api.setResolver(octoprintHostByName). Not the default: a TLS
+ * client connected to a bare address sends no SNI and cannot check the certificate against the hostname.
+ * */
+#if defined(ESP8266) || defined(ESP32)
+bool octoprintHostByName(const char *host, IPAddress &ip) { return WiFi.hostByName(host, ip) == 1; }
+#endif
 
 OctoprintApi::OctoprintApi(void){
 	if (_debug)
@@ -17,6 +30,8 @@ OctoprintApi::OctoprintApi(void){
 	
 }
 
+OctoprintApi::~OctoprintApi() { delete[] _asyncBuffer; }
+
 /** OctoprintApi()
  * IP address version of the client connect function
  * */
@@ -30,6 +45,10 @@ void OctoprintApi::init(Client &client, IPAddress octoPrintIp, int octoPrintPort
   _octoPrintIp    = octoPrintIp;
   _octoPrintPort  = octoPrintPort;
   _usingIpAddress = true;
+  _resolver       = NULL;
+  _resolved       = false;
+  _printJobCache.valid          = false;
+  _printerStatisticsCache.valid = false;
 } 
 
 /** OctoprintApi()
@@ -46,6 +65,10 @@ void OctoprintApi::init(Client &client, char *octoPrintUrl, int octoPrintPort, S
   _octoPrintUrl   = octoPrintUrl;
   _octoPrintPort  = octoPrintPort;
   _usingIpAddress = false;
+  _resolver       = NULL;  // connect by name unless a lookup is asked for
+  _resolved       = false;
+  _printJobCache.valid          = false;
+  _printerStatisticsCache.valid = false;
 }
 
 /** GET YOUR ASS TO OCTOPRINT...
@@ -58,119 +81,334 @@ String OctoprintApi::sendRequestToOctoprint(String type, String command, const c
   if ((type != "GET") && (type != "POST")) {
     if (_debug)
       Serial.println("OctoprintApi::sendRequestToOctoprint() Only GET & POST are supported... exiting.");
+    httpStatusCode = -1;
+    httpErrorBody  = "";
     return "";
   }
 
-  String statusCode       = "";
-  String headers          = "";
-  String body             = "";
-  bool finishedStatusCode = false;
-  bool finishedHeaders    = false;
-  bool currentLineIsBlank = true;
-  int ch_count            = 0;
-  int headerCount         = 0;
-  int headerLineStart     = 0;
-  int bodySize            = -1;
-  unsigned long now;
+  String body = "";
+  if (beginRequest(type == "POST", command.c_str(), data)) {
+    int bodySize = _body.length();
+    body.reserve(bodySize >= 0 && bodySize < maxMessageLength ? bodySize : maxMessageLength);
+
+    unsigned long now = millis();
+    while (!_body.finished() && millis() - now < OPAPI_TIMEOUT) {
+      int c;
+      while ((c = _body.read()) >= 0) {
+        if ((int)body.length() < maxMessageLength)
+          body += (char)c;
+      }
+    }
+  }
+  endRequest();
 
-  bool connected;
+  if(httpStatusCode <= 199 || httpStatusCode >= 300){httpErrorBody = body;} //account for any error codes. Client can decide what to do with Body Contents as a fall back.
 
-  if (_usingIpAddress)
-    connected = _client->connect(_octoPrintIp, _octoPrintPort);
-  else
-    connected = _client->connect(_octoPrintUrl, _octoPrintPort);
+  return body;
+}
 
-  if (connected) {
+/** beginRequest()
+ * Sends the request and reads the status line and headers, leaving the body unread in _body.
+ * Returns true if the server answered, then endRequest() must be called once the body has been consumed.
+ * */
+bool OctoprintApi::beginRequest(bool post, const char *command, const char *data, const responseCache *cache) {
+  if (_asyncState != OPAPI_ASYNC_IDLE) {
     if (_debug)
-      Serial.println(".... connected to server");
+      Serial.println("OctoprintApi::sendRequestToOctoprint() An asynchronous request is still running... exiting.");
+    httpStatusCode = -1;
+    _body.begin(_client, 0, false);
+    return false;
+  }
 
-    char useragent[64];
-    snprintf(useragent, 64, "User-Agent: %s", USER_AGENT);
+  unsigned long now;
+  bool reused = false;
 
-    _client->println(type + " " + command + " HTTP/1.1");
-    _client->print("Host: ");
-    if (_usingIpAddress)
-      _client->println(_octoPrintIp);
-    else
-      _client->println(_octoPrintUrl);
-    _client->print("X-Api-Key: ");
-    _client->println(_apiKey);
-    _client->println(useragent);
-    _client->println("Connection: keep-alive");
-    if (data != NULL) {
-      _client->println("Content-Type: application/json");
-      _client->print("Content-Length: ");
-      _client->println(strlen(data));  // number of bytes in the payload
-      _client->println();              // important need an empty line here
-      _client->println(data);          // the payload
-    } else
-      _client->println();
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!sendRequest(post, command, data, reused, cache))
+      break;
 
     now = millis();
-    while (millis() - now < OPAPI_TIMEOUT) {
-      while (_client->available()) {
-        char c = _client->read();
+    while (!readResponseHeaders(64) && millis() - now < OPAPI_TIMEOUT) {
+      if (reused && !_response.started() && !_client->connected())
+        break;  // the kept-alive socket went stale, nothing is coming back
+    }
 
+    // A reused socket that produced no response at all was closed by the server while idle, so retry once on a fresh one.
+    // Not a POST though: the server may have carried it out before hanging up, and a command must not run twice.
+    if (reused && !_response.started()) {
+      closeClient();
+      if (post) {
         if (_debug)
-          Serial.print(c);
-
-        if (!finishedStatusCode) {
-          if (c == '\n')
-            finishedStatusCode = true;
-          else
-            statusCode = statusCode + c;
-        }
-
-        if (!finishedHeaders) {
-          if (c == '\n') {
-            if (currentLineIsBlank)
-              finishedHeaders = true;
-            else {
-              if (headers.substring(headerLineStart).startsWith("Content-Length: "))
-                bodySize = (headers.substring(headerLineStart + 16)).toInt();
-              headers = headers + c;
-              headerCount++;
-              headerLineStart = headerCount;
-            }
-          } else {
-            headers = headers + c;
-            headerCount++;
-          }
-        } else {
-          if (ch_count < maxMessageLength) {
-            body = body + c;
-            ch_count++;
-            if (ch_count == bodySize)
-              break;
-          }
-        }
-        if (c == '\n')
-          currentLineIsBlank = true;
-        else if (c != '\r') {
-          currentLineIsBlank = false;
-        }
-      }
-      if (ch_count == bodySize)
+          Serial.println("kept-alive connection closed after a POST, not sending it again");
         break;
+      }
+      if (_debug)
+        Serial.println("kept-alive connection was stale, reconnecting");
+      continue;
     }
-  } else {
+    break;
+  }
+
+  return startBody();
+}
+
+/** sendRequest()
+ * Connects (or reuses the kept-alive connection) and writes the whole request, the response is left on the socket.
+ * */
+bool OctoprintApi::sendRequest(bool post, const char *command, const char *data, bool &reused, const responseCache *cache) {
+  _response.reset();
+  metricsBegin(command);
+  bool connected = connectToOctoprint(reused);
+  if (!connected) {
     if (_debug) {
       Serial.println("connection failed");
       Serial.println(connected);
     }
+    return false;
   }
 
-  closeClient();
+  if (_debug)
+    Serial.println(reused ? ".... reusing connection to server" : ".... connected to server");
+  metricsConnected();
+
+  OctoprintRequestBuffer request(_client, requestWrites);
+  writeRequestHead(request, post, command, cache);
+  if (data != NULL) {
+    request.println(F("Content-Type: application/json"));
+    request.print(F("Content-Length: "));
+    request.println(strlen(data));  // number of bytes in the payload
+    request.println();              // important need an empty line here
+    request.print(data);            // the payload, nothing after it or a kept-alive server reads it as the next request
+  } else
+    request.println();
+  bool sent = request.send();
+  metricsSent(request.sent());
+  if (!sent) {
+    if (_debug)
+      Serial.println("request write failed");
+    closeClient();
+    // Most likely closed by the server while idle. A request that did not go out whole cannot have been carried out,
+    // so even a POST is sent once more on a fresh connection.
+    if (reused)
+      return sendRequest(post, command, data, reused, cache);
+    return false;
+  }
+  return true;
+}
+
+/** writeRequestHead()
+ * Request line and the headers every request carries, the caller adds its own and the empty line.
+ * */
+void OctoprintApi::writeRequestHead(Print &request, bool post, const char *command, const responseCache *cache) {
+  request.print(post ? F("POST ") : F("GET "));
+  request.print(command);
+  request.println(F(" HTTP/1.1"));
+  request.print(F("Host: "));
+  if (_usingIpAddress)
+    request.println(_octoPrintIp);
+  else
+    request.println(_octoPrintUrl);
+  request.print(F("X-Api-Key: "));
+  request.println(_apiKey);
+  request.print(F("User-Agent: "));
+  request.println(F(USER_AGENT));
+  request.println(_keepAlive ? F("Connection: keep-alive") : F("Connection: close"));
+#ifdef OPAPI_GZIP
+  request.println(F("Accept-Encoding: gzip, deflate"));
+#endif
+  if (cache != NULL && cache->valid) {
+    if (cache->etag[0]) {
+      request.print(F("If-None-Match: "));
+      request.println(cache->etag);
+    }
+    if (cache->lastModified[0]) {
+      request.print(F("If-Modified-Since: "));
+      request.println(cache->lastModified);
+    }
+  }
+}
+
+/** readResponseHeaders()
+ * Feeds at most budget waiting bytes to the header parser, returns true once the headers are complete.
+ * */
+bool OctoprintApi::readResponseHeaders(int budget) {
+  int read = 0;
+  while (!_response.finished() && read < budget && _client->available()) {
+    char c = _client->read();
+    read++;
+
+    if (_debug)
+      Serial.print(c);
+
+    _response.parse(c);
+  }
+  if (read > 0) {
+    metricsFirstByte();
+    metricsReceived(read);
+  }
+  return _response.finished();
+}
 
-  int httpCode = extractHttpCode(statusCode, body);
+/** startBody()
+ * Takes over what the header parser found and points _body at the response body.
+ * */
+bool OctoprintApi::startBody() {
+  httpStatusCode = _response.statusCode;
   if (_debug) {
     Serial.print("\nhttpCode:");
-    Serial.println(httpCode);
+    Serial.println(httpStatusCode);
   }
-  httpStatusCode = httpCode;
-  if(httpStatusCode <= 199 || httpStatusCode >= 300){httpErrorBody = body;} //account for any error codes. Client can decide what to do with Body Contents as a fall back.
 
-  return body;
+  if (!_response.finished()) {
+    _body.begin(_client, 0, false);
+    return false;
+  }
+  metricsHeaders();
+  if (_response.keepAliveTimeout >= 0)
+    _keepAliveIdle = _response.keepAliveTimeout * 1000;
+  if (_response.keepAliveMax >= 0)
+    _keepAliveRemaining = _response.keepAliveMax;
+
+  long bodySize = _response.contentLength;
+  bool chunked  = _response.chunked;
+  // 1xx, 204 and 304 responses never carry a body
+  if ((httpStatusCode >= 100 && httpStatusCode <= 199) || httpStatusCode == 204 || httpStatusCode == 304) {
+    bodySize = 0;
+    chunked  = false;
+  }
+  _body.begin(_client, bodySize, chunked, _response.contentEncoding);
+  _body.debug = _debug;
+  return true;
+}
+
+/** endRequest()
+ * Finishes the response started by beginRequest(), keeping the socket for the next call when keep-alive allows it.
+ * */
+void OctoprintApi::endRequest() {
+  if (_asyncState != OPAPI_ASYNC_IDLE)
+    return;  // the socket belongs to the asynchronous request
+
+  // Skip whatever the parser did not need, there is no point paying for a reconnect to avoid reading a few bytes.
+  if (_keepAlive && _response.keepAlive && _body.framed()) {
+    unsigned long now = millis();
+    while (!_body.finished() && millis() - now < OPAPI_TIMEOUT) {
+      while (_body.read() >= 0)
+        ;
+    }
+  }
+
+  // Only keep the socket when the whole body was consumed, otherwise the next response would be misaligned.
+  if (_keepAlive && _response.keepAlive && _body.framed() && _body.finished() && httpStatusCode > 0 && _keepAliveRemaining != 0) {
+    _connectionReusable = true;
+    _lastResponseTime   = millis();
+    if (_keepAliveRemaining > 0)
+      _keepAliveRemaining--;
+  } else
+    closeClient();
+  metricsEnd();
+}
+
+/** beginGetToOctoprint()
+ * Streaming version of sendGetToOctoprint(), returns true with the body ready to be parsed from _body on a 2xx reply.
+ * With a cache the request is made conditional and a 304 Not Modified also returns true (with an empty body).
+ * Anything else lands in httpErrorBody and the request is already finished.
+ * */
+bool OctoprintApi::beginGetToOctoprint(const char *command, const responseCache *cache) {
+  if (_debug)
+    Serial.println("OctoprintApi::beginGetToOctoprint() CALLED");
+
+  if (beginRequest(false, command, NULL, cache) &&
+      ((httpStatusCode >= 200 && httpStatusCode <= 299) || (cache != NULL && httpStatusCode == 304)))
+    return true;
+
+  readErrorBody();
+  return false;
+}
+
+/** readErrorBody()
+ * Keeps the body of a failed request in httpErrorBody and finishes the request.
+ * */
+void OctoprintApi::readErrorBody() {
+  httpErrorBody = "";
+  unsigned long now = millis();
+  while (!_body.finished() && millis() - now < OPAPI_TIMEOUT) {
+    int c;
+    while ((c = _body.read()) >= 0) {
+      if ((int)httpErrorBody.length() < maxMessageLength)
+        httpErrorBody += (char)c;
+    }
+  }
+  endRequest();
+  if (_debug && httpErrorBody != "")
+    Serial.println(httpErrorBody);
+}
+
+/** readErrorText()
+ * readErrorBody() for the String free calls: keeps the start of the body in text and leaves httpErrorBody alone.
+ * */
+void OctoprintApi::readErrorText(char *text, size_t size) {
+  size_t length     = 0;
+  unsigned long now = millis();
+  while (!_body.finished() && millis() - now < OPAPI_TIMEOUT) {
+    int c;
+    while ((c = _body.read()) >= 0) {
+      if (length < size - 1)
+        text[length++] = c;
+    }
+  }
+  text[length] = '\0';
+  endRequest();
+}
+
+/** nextElement()
+ * For reading a JSON array straight off _body one element at a time: steps over the separators in front of the next
+ * object and returns true when one starts, false at the closing bracket or when the body runs dry.
+ * */
+bool OctoprintApi::nextElement() {
+  unsigned long now = millis();
+  while (millis() - now < OPAPI_TIMEOUT) {
+    int c = _body.peek();
+    if (c < 0) {
+      if (_body.finished())
+        return false;
+      continue;
+    }
+    if (c == ']')
+      return false;
+    if (c == '{')
+      return true;
+    _body.read();  // '[', ',' and whitespace
+  }
+  return false;
+}
+
+/** connectToOctoprint()
+ * Opens a connection to the server, or hands back the kept-alive one if it is still usable.
+ * reused is set when an existing socket is returned, so the caller knows a retry may be needed.
+ * */
+bool OctoprintApi::connectToOctoprint(bool &reused) {
+  if (!reused && _connectionReusable) {
+    if (millis() - _lastResponseTime < _keepAliveIdle && _client->connected()) {
+      reused = true;
+      return true;
+    }
+    closeClient();
+  }
+  reused              = false;
+  _keepAliveIdle      = OPAPI_KEEPALIVE_IDLE;
+  _keepAliveRemaining = -1;
+
+  if (_usingIpAddress)
+    return _client->connect(_octoPrintIp, _octoPrintPort);
+  if ((_resolved && millis() - _resolvedAt < OPAPI_DNS_TTL) || resolveHost()) {
+    if (_client->connect(_resolvedIp, _octoPrintPort))
+      return true;
+    _resolved = false;  // the server may have moved, look it up again next time
+    if (_debug)
+      Serial.println("OctoprintApi::connectToOctoprint() Cached address failed, dropped it");
+    return false;
+  }
+  return _client->connect(_octoPrintUrl, _octoPrintPort);
 }
 
 String OctoprintApi::sendGetToOctoprint(String command) {
@@ -187,10 +425,14 @@ String OctoprintApi::sendGetToOctoprint(String command) {
  * 200 OK – No error
  * */
 bool OctoprintApi::getOctoprintVersion() {
-  String response = sendGetToOctoprint("/api/version");
+  if (!beginGetToOctoprint("/api/version"))
+    return false;
+
   StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+  DeserializationError error = deserializeJson(root, _body);
+  endRequest();
 
-  if (!deserializeJson(root, response) && root.containsKey("api")) {
+  if (!error && root.containsKey("api")) {
     octoprintVer.octoprintApi    = (const char *)root["api"];
     octoprintVer.octoprintServer = (const char *)root["server"];
     return true;
@@ -203,61 +445,190 @@ bool OctoprintApi::getOctoprintVersion() {
  * Retrieves the current state of the printer.
  * Returns a 200 OK with a Full State Response in the body upon success.
  * */
-bool OctoprintApi::getPrinterStatistics() {
-  String response = sendGetToOctoprint("/api/printer");  //recieve reply from OctoPrint
+bool OctoprintApi::getPrinterStatistics() { return updatePrinterStatistics() != OPAPI_UPDATE_FAILED; }
+
+/** updatePrinterStatistics()
+ * Same as getPrinterStatistics(), but tells whether printerStats actually changed. The request carries the
+ * ETag/Last-Modified validators of the last answer, and a 304 or a byte-identical body leaves printerStats untouched.
+ * */
+OctoprintUpdate OctoprintApi::updatePrinterStatistics() {
+  if (!beginGetToOctoprint("/api/printer", &_printerStatisticsCache))  //recieve reply from OctoPrint
+    return printerStatisticsFailed() ? OPAPI_UPDATE_CHANGED : OPAPI_UPDATE_FAILED;
+  if (httpStatusCode == 304) {
+    endRequest();
+    return OPAPI_UPDATE_UNCHANGED;
+  }
+
+  StaticJsonDocument<128> filter;
+  printerStatisticsFilter(filter);
 
   StaticJsonDocument<JSONDOCUMENT_SIZE> root;
-  if (!deserializeJson(root, response)) {
-    if (root.containsKey("state")) {
-      printerStats.printerState              = (const char *)root["state"]["text"];
-      printerStats.printerStateclosedOrError = root["state"]["flags"]["closedOrError"];
-      printerStats.printerStateerror         = root["state"]["flags"]["error"];
-      printerStats.printerStatefinishing     = root["state"]["flags"]["finishing"];
-      printerStats.printerStateoperational   = root["state"]["flags"]["operational"];
-      printerStats.printerStatepaused        = root["state"]["flags"]["paused"];
-      printerStats.printerStatepausing       = root["state"]["flags"]["pausing"];
-      printerStats.printerStatePrinting      = root["state"]["flags"]["printing"];
-      printerStats.printerStateready         = root["state"]["flags"]["ready"];
-      printerStats.printerStateresuming      = root["state"]["flags"]["resuming"];
-      printerStats.printerStatesdReady       = root["state"]["flags"]["sdReady"];
-    }
+  OctoprintUpdate update = readCachedBody(root, filter, _printerStatisticsCache);
+  if (update == OPAPI_UPDATE_CHANGED)
+    parsePrinterStatistics(root);
+  else if (update == OPAPI_UPDATE_FAILED)
+    printerStats.printerStateoperational = false;
+  return update;
+}
 
-    printerStats.printerBedAvailable   = false;
-    printerStats.printerTool0Available = false;
-    printerStats.printerTool1Available = false;
-    if (root.containsKey("temperature")) {
-      if (root["temperature"].containsKey("bed")) {
-        printerStats.printerBedTempActual = root["temperature"]["bed"]["actual"];
-        printerStats.printerBedTempTarget = root["temperature"]["bed"]["target"];
-        printerStats.printerBedTempOffset = root["temperature"]["bed"]["offset"];
-        printerStats.printerBedAvailable  = true;
-      }
+void OctoprintApi::printerStatisticsFilter(JsonDocument &filter) {
+  filter["state"]       = true;
+  filter["temperature"] = true;
+}
 
-      if (root["temperature"].containsKey("tool0")) {
-        printerStats.printerTool0TempActual = root["temperature"]["tool0"]["actual"];
-        printerStats.printerTool0TempTarget = root["temperature"]["tool0"]["target"];
-        printerStats.printerTool0TempOffset = root["temperature"]["tool0"]["offset"];
-        printerStats.printerTool0Available  = true;
-      }
+void OctoprintApi::parsePrinterStatistics(JsonDocument &root) {
+  if (root.containsKey("state"))
+    parsePrinterState(root["state"]);
+  parseTemperatures(root["temperature"]);
+}
 
-      if (root["temperature"].containsKey("tool1")) {
-        printerStats.printerTool1TempActual = root["temperature"]["tool1"]["actual"];
-        printerStats.printerTool1TempTarget = root["temperature"]["tool1"]["target"];
-        printerStats.printerTool1TempOffset = root["temperature"]["tool1"]["offset"];
-        printerStats.printerTool1Available  = true;
-      }
+void OctoprintApi::parsePrinterState(JsonObject state) {
+  printerStats.printerState              = (const char *)state["text"];
+  printerStats.printerStateclosedOrError = state["flags"]["closedOrError"];
+  printerStats.printerStateerror         = state["flags"]["error"];
+  printerStats.printerStatefinishing     = state["flags"]["finishing"];
+  printerStats.printerStateoperational   = state["flags"]["operational"];
+  printerStats.printerStatepaused        = state["flags"]["paused"];
+  printerStats.printerStatepausing       = state["flags"]["pausing"];
+  printerStats.printerStatePrinting      = state["flags"]["printing"];
+  printerStats.printerStateready         = state["flags"]["ready"];
+  printerStats.printerStateresuming      = state["flags"]["resuming"];
+  printerStats.printerStatesdReady       = state["flags"]["sdReady"];
+}
+
+/**
+ * Walks the temperature object once. Every toolN up to OPAPI_MAX_TOOLS lands in the printerTool* arrays, tool0 and
+ * tool1 are mirrored into their own fields as before, and keys this library does not know (history...) are skipped.
+ * */
+void OctoprintApi::parseTemperatures(JsonObject temperature) {
+  printerStats.printerBedAvailable     = false;
+  printerStats.printerChamberAvailable = false;
+  printerStats.printerTool0Available   = false;
+  printerStats.printerTool1Available   = false;
+  printerStats.printerToolCount        = 0;
+  for (int i = 0; i < OPAPI_MAX_TOOLS; i++) {  // a tool missing in between reads 0, not what it read last time
+    printerStats.printerToolTempActual[i] = 0;
+    printerStats.printerToolTempTarget[i] = 0;
+    printerStats.printerToolTempOffset[i] = 0;
+  }
+
+  for (JsonPair sensor : temperature) {
+    const char *name = sensor.key().c_str();
+    JsonObject value = sensor.value();
+
+    if (strcmp(name, "bed") == 0) {
+      printerStats.printerBedTempActual = value["actual"];
+      printerStats.printerBedTempTarget = value["target"];
+      printerStats.printerBedTempOffset = value["offset"];
+      printerStats.printerBedAvailable  = true;
+    } else if (strcmp(name, "chamber") == 0) {
+      printerStats.printerChamberTempActual = value["actual"];
+      printerStats.printerChamberTempTarget = value["target"];
+      printerStats.printerChamberTempOffset = value["offset"];
+      printerStats.printerChamberAvailable  = true;
+    } else if (strncmp(name, "tool", 4) == 0 && name[4] >= '0' && name[4] <= '9') {
+      int tool = atoi(name + 4);
+      if (tool >= OPAPI_MAX_TOOLS)
+        continue;
+      printerStats.printerToolTempActual[tool] = value["actual"];
+      printerStats.printerToolTempTarget[tool] = value["target"];
+      printerStats.printerToolTempOffset[tool] = value["offset"];
+      if (tool >= printerStats.printerToolCount)
+        printerStats.printerToolCount = tool + 1;
     }
+  }
+
+  if (printerStats.printerToolCount > 0) {
+    printerStats.printerTool0TempActual = printerStats.printerToolTempActual[0];
+    printerStats.printerTool0TempTarget = printerStats.printerToolTempTarget[0];
+    printerStats.printerTool0TempOffset = printerStats.printerToolTempOffset[0];
+    printerStats.printerTool0Available  = true;
+  }
+  if (printerStats.printerToolCount > 1) {
+    printerStats.printerTool1TempActual = printerStats.printerToolTempActual[1];
+    printerStats.printerTool1TempTarget = printerStats.printerToolTempTarget[1];
+    printerStats.printerTool1TempOffset = printerStats.printerToolTempOffset[1];
+    printerStats.printerTool1Available  = true;
+  }
+}
+
+/**
+ * OctoPrint answers 409 with a plain text body while no printer is connected, which is still a valid state to report.
+ * */
+bool OctoprintApi::printerStatisticsFailed() {
+  printerStats.printerStateoperational = false;
+  _printerStatisticsCache.valid        = false;
+  if (httpErrorBody == "Printer is not operational") {
+    printerStats.printerState = httpErrorBody;
     return true;
-  } else {
-    printerStats.printerStateoperational = false;
-    if (response == "Printer is not operational") {
-      printerStats.printerState = response;
-      return true;
-    }
   }
   return false;
 }
 
+/***** FIXED COMMANDS *****/
+/**
+ * Endpoint and payload of every command that takes no argument. The table lives in flash (PROGMEM on AVR and
+ * ESP8266) and is copied onto the stack only while the command is sent, so these calls build no String at all.
+ * */
+enum octoprintCommandId {
+  OPAPI_JOB_START,
+  OPAPI_JOB_CANCEL,
+  OPAPI_JOB_RESTART,
+  OPAPI_JOB_PAUSE_RESUME,
+  OPAPI_JOB_PAUSE,
+  OPAPI_JOB_RESUME,
+  OPAPI_CORE_SHUTDOWN,
+  OPAPI_CORE_REBOOT,
+  OPAPI_CORE_RESTART,
+  OPAPI_CONNECTION_CONNECT,
+  OPAPI_CONNECTION_DISCONNECT,
+  OPAPI_CONNECTION_FAKE_ACK,
+  OPAPI_PRINTHEAD_HOME,
+  OPAPI_SD_INIT,
+  OPAPI_SD_REFRESH,
+  OPAPI_SD_RELEASE
+};
+
+struct octoprintCommand {
+  char endpoint[36];
+  char payload[44];
+};
+
+static const octoprintCommand octoprintCommands[] PROGMEM = {
+    {"/api/job", "{\"command\":\"start\"}"},
+    {"/api/job", "{\"command\":\"cancel\"}"},
+    {"/api/job", "{\"command\":\"restart\"}"},
+    {"/api/job", "{\"command\":\"pause\"}"},
+    {"/api/job", "{\"command\":\"pause\",\"action\":\"pause\"}"},
+    {"/api/job", "{\"command\":\"pause\",\"action\":\"resume\"}"},
+    {"/api/system/commands/core/shutdown", ""},
+    {"/api/system/commands/core/reboot", ""},
+    {"/api/system/commands/core/restart", ""},
+    {"/api/connection", "{\"command\":\"connect\"}"},
+    {"/api/connection", "{\"command\":\"disconnect\"}"},
+    {"/api/connection", "{\"command\":\"fake_ack\"}"},
+    {"/api/printer/printhead", "{\"command\":\"home\",\"axes\":[\"x\",\"y\"]}"},
+    {"/api/printer/sd", "{\"command\":\"init\"}"},
+    {"/api/printer/sd", "{\"command\":\"refresh\"}"},
+    {"/api/printer/sd", "{\"command\":\"release\"}"}};
+
+/** sendCommand()
+ * POSTs one entry of octoprintCommands, returns true on the 204 No Content all of them answer with.
+ * */
+bool OctoprintApi::sendCommand(uint8_t id) {
+  if (_debug)
+    Serial.println("OctoprintApi::sendCommand() CALLED");
+
+  octoprintCommand command;
+  memcpy_P(&command, &octoprintCommands[id], sizeof(command));
+
+  if (beginRequest(true, command.endpoint, command.payload) && httpStatusCode >= 200 && httpStatusCode <= 299)
+    endRequest();
+  else
+    readErrorBody();
+  return (httpStatusCode == 204);
+}
+
 /***** PRINT JOB OPPERATIONS *****/
 /**
  * http://docs.octoprint.org/en/devel/api/job.html#issue-a-job-command
@@ -268,33 +639,27 @@ bool OctoprintApi::getPrinterStatistics() {
  * Upon success, a status code of 204 No Content and an empty body is returned.
  * */
 bool OctoprintApi::octoPrintJobStart() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"start\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_START);
 }
 
 bool OctoprintApi::octoPrintJobCancel() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"cancel\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_CANCEL);
 }
 
 bool OctoprintApi::octoPrintJobRestart() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"restart\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_RESTART);
 }
 
 bool OctoprintApi::octoPrintJobPauseResume() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"pause\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_PAUSE_RESUME);
 }
 
 bool OctoprintApi::octoPrintJobPause() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"pause\", \"action\": \"pause\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_PAUSE);
 }
 
 bool OctoprintApi::octoPrintJobResume() {
-  sendPostToOctoPrint("/api/job", "{\"command\": \"pause\", \"action\": \"resume\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_JOB_RESUME);
 }
 
 bool OctoprintApi::octoPrintFileSelect(String &path) {
@@ -302,6 +667,201 @@ bool OctoprintApi::octoPrintFileSelect(String &path) {
   return (httpStatusCode == 204);
 }
 
+/** octoPrintListFiles()
+ * http://docs.octoprint.org/en/master/api/files.html#retrieve-files-from-specific-location
+ * Lists the local files and folders one level at a time, the root or the given folder ("models/parts").
+ * The listing is read off the socket one entry at a time and handed to callback, so it takes the same memory however
+ * many files there are. Return false from the callback to stop early, e.g. once a screen is full.
+ * offset entries are skipped first and at most limit (0 for all) are handed over, for paging through a big folder.
+ * */
+bool OctoprintApi::octoPrintListFiles(OctoprintFileCallback callback, const char *folder, int offset, int limit) {
+  char command[OPAPI_FILE_PATH_SIZE * 3 + 48];
+  int length = snprintf(command, sizeof(command), "/api/files/local");
+  if (folder != NULL && folder[0]) {
+    command[length++] = '/';
+    for (const char *c = folder; *c && length < (int)sizeof(command) - 4; c++) {
+      if (isalnum(*c) || strchr("/-_.~", *c))
+        command[length++] = *c;
+      else
+        length += snprintf(command + length, 4, "%%%02X", (uint8_t)*c);
+    }
+  }
+  snprintf(command + length, sizeof(command) - length, "?recursive=false");
+
+  if (!beginGetToOctoprint(command))
+    return false;
+
+  StaticJsonDocument<192> filter;
+  filter["name"]                                = true;
+  filter["path"]                                = true;
+  filter["type"]                                = true;
+  filter["size"]                                = true;
+  filter["date"]                                = true;
+  filter["gcodeAnalysis"]["estimatedPrintTime"] = true;
+
+  // The root answers {"files": [...]}, a folder answers with its own entry and the contents in "children".
+  bool success = _body.find((char *)(folder != NULL && folder[0] ? "\"children\"" : "\"files\""));
+  bool stopped = false;
+  for (int index = 0; success && !stopped && nextElement(); index++) {
+    StaticJsonDocument<JSONDOCUMENT_SIZE / 2> entry;
+    DeserializationError error = deserializeJson(entry, _body, DeserializationOption::Filter(filter));
+    if (error) {
+      if (_debug) {
+        Serial.print("OctoprintApi::octoPrintListFiles() ");
+        Serial.println(error.c_str());
+      }
+      success = false;
+      break;
+    }
+    if (index < offset)
+      continue;
+
+    octoprintFile file;
+    snprintf(file.name, sizeof(file.name), "%s", (const char *)(entry["name"] | ""));
+    snprintf(file.path, sizeof(file.path), "%s", (const char *)(entry["path"] | ""));
+    file.folder             = entry["type"] == "folder";
+    file.size               = entry["size"] | 0L;
+    file.date               = entry["date"] | 0L;
+    file.estimatedPrintTime = entry["gcodeAnalysis"]["estimatedPrintTime"] | 0.0;
+
+    stopped = !callback(this, file) || (limit > 0 && index + 1 - offset >= limit);
+  }
+
+  if (stopped)
+    closeClient();  // cheaper than reading the rest of a big listing just to keep the connection
+  else
+    endRequest();
+  return success;
+}
+
+/** octoPrintUploadFile()
+ * http://docs.octoprint.org/en/master/api/files.html#upload-file-or-create-folder
+ * Uploads size bytes read from source (an SD card File, Serial...) to path on the local storage, e.g. "parts/gear.gcode".
+ * The file goes out as multipart/form-data in OPAPI_UPLOAD_CHUNK_SIZE pieces straight from source, it is never held in
+ * memory. progress is called after every piece, uploadThroughput holds the bytes per second once done.
+ * Returns true on the 201 Created OctoPrint answers with.
+ * */
+bool OctoprintApi::octoPrintUploadFile(const char *path, Stream &source, unsigned long size, OctoprintUploadCallback progress) {
+  if (_asyncState != OPAPI_ASYNC_IDLE) {
+    httpStatusCode = -1;
+    return false;
+  }
+
+  const char *name = strrchr(path, '/');
+  int folderLength = name != NULL ? name - path : 0;
+  name             = name != NULL ? name + 1 : path;
+
+  char head[OPAPI_FILE_PATH_SIZE + 160];
+  char tail[OPAPI_FILE_PATH_SIZE + 96];
+  int headLength = snprintf(head, sizeof(head),
+                            "--" OPAPI_UPLOAD_BOUNDARY "\r\n"
+                            "Content-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+                            "Content-Type: application/octet-stream\r\n\r\n",
+                            name);
+  int tailLength = snprintf(tail, sizeof(tail),
+                            "\r\n--" OPAPI_UPLOAD_BOUNDARY "\r\n"
+                            "Content-Disposition: form-data; name=\"path\"\r\n\r\n"
+                            "%.*s\r\n"
+                            "--" OPAPI_UPLOAD_BOUNDARY "--\r\n",
+                            folderLength, path);
+  if (headLength >= (int)sizeof(head) || tailLength >= (int)sizeof(tail)) {
+    httpStatusCode = -1;
+    return false;  // path longer than OPAPI_FILE_PATH_SIZE
+  }
+
+  // The source cannot be rewound for a retry, so never risk a kept-alive socket the server may have dropped.
+  closeClient();
+  _response.reset();
+  metricsBegin("/api/files/local");
+  bool reused = false;
+  if (!connectToOctoprint(reused)) {
+    if (_debug)
+      Serial.println("connection failed");
+    httpStatusCode = -1;
+    metricsEnd();
+    return false;
+  }
+  metricsConnected();
+
+  OctoprintRequestBuffer request(_client, requestWrites);
+  writeRequestHead(request, true, "/api/files/local", NULL);
+  request.println(F("Content-Type: multipart/form-data; boundary=" OPAPI_UPLOAD_BOUNDARY));
+  request.print(F("Content-Length: "));
+  request.println(headLength + size + tailLength);
+  request.println();
+  request.print(head);
+  bool headSent = request.send();
+  metricsSent(request.sent());
+  if (!headSent)
+    return uploadFailed("upload write failed");
+
+  unsigned long start = millis();
+  unsigned long sent  = 0;
+  uint8_t chunk[OPAPI_UPLOAD_CHUNK_SIZE];
+  while (sent < size) {
+    size_t length = size - sent < sizeof(chunk) ? size - sent : sizeof(chunk);
+    length        = source.readBytes(chunk, length);
+    if (length == 0)
+      return uploadFailed("upload source ran dry");
+    if (!writeAll(chunk, length))
+      return uploadFailed("upload write failed");
+    metricsSent(length);
+    sent += length;
+    if (progress)
+      progress(this, sent, size);
+  }
+  if (!writeAll((const uint8_t *)tail, tailLength))
+    return uploadFailed("upload write failed");
+  metricsSent(tailLength);
+  unsigned long elapsed = millis() - start;
+  uploadThroughput      = elapsed > 0 ? size * 1000.0 / elapsed : 0;
+
+  unsigned long now = millis();
+  while (!readResponseHeaders(64) && millis() - now < OPAPI_TIMEOUT)
+    ;
+  if (startBody() && httpStatusCode == 201)
+    endRequest();
+  else
+    readErrorBody();
+  return (httpStatusCode == 201);
+}
+
+/** uploadFailed()
+ * The upload cannot go on: the server is left with a truncated body, so the connection is dropped.
+ * */
+bool OctoprintApi::uploadFailed(const char *reason) {
+  if (_debug)
+    Serial.println(reason);
+  closeClient();
+  httpStatusCode = -1;
+  metricsEnd();
+  return false;
+}
+
+/** writeAll()
+ * Client::write() may take only part of a buffer when the socket is backed up, keep going until all of it is out.
+ * Gives up when the connection drops or nothing goes out for OPAPI_TIMEOUT ms.
+ * */
+static bool clientWriteAll(Client *client, const uint8_t *buffer, size_t size, unsigned long &writes) {
+  unsigned long now = millis();
+  while (size > 0 && millis() - now < OPAPI_TIMEOUT) {
+    size_t written = client->write(buffer, size);
+    writes++;
+    if (written == 0) {
+      if (!client->connected())
+        return false;
+      yield();
+      continue;
+    }
+    buffer += written;
+    size -= written;
+    now = millis();
+  }
+  return size == 0;
+}
+
+bool OctoprintApi::writeAll(const uint8_t *buffer, size_t size) { return clientWriteAll(_client, buffer, size, requestWrites); }
+
 //bool OctoprintApi::octoPrintJobPause(String actionCommand){}
 
 /***** SYSTEM COMMANDS *****/
@@ -311,18 +871,15 @@ bool OctoprintApi::octoPrintFileSelect(String &path) {
  * action: shutdown, reboot, restart 
  * */
 bool OctoprintApi::octoPrintCoreShutdown() {
-  sendPostToOctoPrint("/api/system/commands/core/shutdown","");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CORE_SHUTDOWN);
 }
 
 bool OctoprintApi::octoPrintCoreReboot() {
-  sendPostToOctoPrint("/api/system/commands/core/reboot","");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CORE_REBOOT);
 }
 
 bool OctoprintApi::octoPrintCoreRestart() {
-  sendPostToOctoPrint("/api/system/commands/core/restart","");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CORE_RESTART);
 }
 
 /** getPrintJob
@@ -330,37 +887,250 @@ bool OctoprintApi::octoPrintCoreRestart() {
  * Retrieve information about the current job (if there is one).
  * Returns a 200 OK with a Job information response in the body.
  * */
-bool OctoprintApi::getPrintJob() {
-  String response = sendGetToOctoprint("/api/job");
+bool OctoprintApi::getPrintJob() { return updatePrintJob() != OPAPI_UPDATE_FAILED; }
+
+/** updatePrintJob()
+ * Same as getPrintJob(), but tells whether printJob actually changed, so a display can skip redrawing.
+ * */
+OctoprintUpdate OctoprintApi::updatePrintJob() {
+  if (!beginGetToOctoprint("/api/job", &_printJobCache))
+    return OPAPI_UPDATE_FAILED;
+  if (httpStatusCode == 304) {
+    endRequest();
+    return OPAPI_UPDATE_UNCHANGED;
+  }
+
+  StaticJsonDocument<256> filter;
+  printJobFilter(filter);
 
   StaticJsonDocument<JSONDOCUMENT_SIZE> root;
-  if (!deserializeJson(root, response)) {
-    printJob.printerState = (const char *)root["state"];
-
-    if (root.containsKey("job")) {
-      printJob.estimatedPrintTime = root["job"]["estimatedPrintTime"];
-
-      printJob.jobFileDate   = root["job"]["file"]["date"];
-      printJob.jobFileName   = (const char *)(root["job"]["file"]["name"] | "");
-      printJob.jobFileOrigin = (const char *)(root["job"]["file"]["origin"] | "");
-      printJob.jobFileSize   = root["job"]["file"]["size"];
-	  printJob.jobFilePath = (const char *)(root["job"]["file"]["path"] | "");
-
-      printJob.jobFilamentTool0Length = root["job"]["filament"]["tool0"]["length"] | 0;
-      printJob.jobFilamentTool0Volume = root["job"]["filament"]["tool0"]["volume"] | 0.0;
-      printJob.jobFilamentTool1Length = root["job"]["filament"]["tool1"]["length"] | 0;
-      printJob.jobFilamentTool1Volume = root["job"]["filament"]["tool1"]["volume"] | 0.0;
-    }
-    if (root.containsKey("progress")) {
-      printJob.progressCompletion          = root["progress"]["completion"] | 0.0;
-      printJob.progressFilepos             = root["progress"]["filepos"];
-      printJob.progressPrintTime           = root["progress"]["printTime"];
-      printJob.progressPrintTimeLeft       = root["progress"]["printTimeLeft"];
-      printJob.progressprintTimeLeftOrigin = (const char *)root["progress"]["printTimeLeftOrigin"];
+  OctoprintUpdate update = readCachedBody(root, filter, _printJobCache);
+  if (update == OPAPI_UPDATE_CHANGED)
+    parsePrintJob(root.as<JsonObject>());
+  return update;
+}
+
+/** readCachedBody()
+ * Parses the body of a cached getter and ends the request. A body that fits OPAPI_ASYNC_BUFFER_SIZE is read into the
+ * body buffer first and only parsed when its hash differs from last time, as poll() does; compressed, chunked and
+ * bigger bodies are parsed straight off the socket and compared afterwards.
+ * */
+OctoprintUpdate OctoprintApi::readCachedBody(JsonDocument &root, JsonDocument &filter, responseCache &cache) {
+  long length = _response.contentLength;
+  if (!_response.chunked && _response.contentEncoding == OPAPI_ENCODING_IDENTITY && length >= 0 &&
+      length < OPAPI_ASYNC_BUFFER_SIZE && allocateBodyBuffer()) {
+    length               = _body.readBytes(_asyncBuffer, length);
+    _asyncBuffer[length] = '\0';
+    endRequest();
+    if (!_body.finished())
+      return OPAPI_UPDATE_FAILED;
+    if (!updateCache(cache, _body.hash()))
+      return OPAPI_UPDATE_UNCHANGED;  // byte-identical body, no need to even deserialize it
+    if (!deserializeJson(root, _asyncBuffer, length, DeserializationOption::Filter(filter)))
+      return OPAPI_UPDATE_CHANGED;
+    cache.valid = false;  // do not take the same broken body for an unchanged one next time
+    return OPAPI_UPDATE_FAILED;
+  }
+
+  DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+  endRequest();
+  if (error)
+    return OPAPI_UPDATE_FAILED;
+  return updateCache(cache, _body.hash()) ? OPAPI_UPDATE_CHANGED : OPAPI_UPDATE_UNCHANGED;
+}
+
+/** updateCache()
+ * Remember the validators and body hash of a good response, returns false when the body is the same as last time.
+ * */
+bool OctoprintApi::updateCache(responseCache &cache, uint32_t bodyHash) {
+  bool changed = !cache.valid || cache.bodyHash != bodyHash;
+  strcpy(cache.etag, _response.etag);
+  strcpy(cache.lastModified, _response.lastModified);
+  cache.bodyHash = bodyHash;
+  cache.valid    = true;
+  return changed;
+}
+
+void OctoprintApi::printJobFilter(JsonDocument &filter) {
+  filter["state"]                     = true;
+  filter["job"]["estimatedPrintTime"] = true;
+  filter["job"]["file"]               = true;
+  filter["job"]["filament"]           = true;
+  filter["progress"]                  = true;
+}
+
+void OctoprintApi::parsePrintJob(JsonObject root) {
+  printJob.printerState = (const char *)root["state"];
+
+  if (root.containsKey("job")) {
+    printJob.estimatedPrintTime = root["job"]["estimatedPrintTime"];
+
+    printJob.jobFileDate   = root["job"]["file"]["date"];
+    printJob.jobFileName   = (const char *)(root["job"]["file"]["name"] | "");
+    printJob.jobFileOrigin = (const char *)(root["job"]["file"]["origin"] | "");
+    printJob.jobFileSize   = root["job"]["file"]["size"];
+    printJob.jobFilePath   = (const char *)(root["job"]["file"]["path"] | "");
+
+    printJob.jobFilamentTool0Length = root["job"]["filament"]["tool0"]["length"] | 0;
+    printJob.jobFilamentTool0Volume = root["job"]["filament"]["tool0"]["volume"] | 0.0;
+    printJob.jobFilamentTool1Length = root["job"]["filament"]["tool1"]["length"] | 0;
+    printJob.jobFilamentTool1Volume = root["job"]["filament"]["tool1"]["volume"] | 0.0;
+  }
+  if (root.containsKey("progress")) {
+    printJob.progressCompletion          = root["progress"]["completion"] | 0.0;
+    printJob.progressFilepos             = root["progress"]["filepos"];
+    printJob.progressPrintTime           = root["progress"]["printTime"];
+    printJob.progressPrintTimeLeft       = root["progress"]["printTimeLeft"] | -1L;  // null until OctoPrint has an estimate
+    printJob.progressprintTimeLeftOrigin = (const char *)root["progress"]["printTimeLeftOrigin"];
+  }
+}
+
+/***** SNAPSHOTS *****/
+/**
+ * getPrinterSnapshot() and getJobSnapshot() fetch the same data as getPrinterStatistics() and getPrintJob(), but parse
+ * it straight into the compact printerSnapshot/jobSnapshot the caller owns. No String is touched, the state is an
+ * OctoprintState to compare against, and the structs can be copied around freely, e.g. to double buffer a display.
+ * */
+struct octoprintName {
+  const char *name;
+  uint8_t value;
+};
+
+// Matched on the start of the text, so "Printing from SD" is printing and "Offline after error" offline.
+static const octoprintName octoprintStates[] = {{"Printing", OPAPI_STATE_PRINTING},
+                                                {"Sending file", OPAPI_STATE_PRINTING},
+                                                {"Starting", OPAPI_STATE_PRINTING},
+                                                {"Pausing", OPAPI_STATE_PAUSING},
+                                                {"Paused", OPAPI_STATE_PAUSED},
+                                                {"Resuming", OPAPI_STATE_RESUMING},
+                                                {"Cancelling", OPAPI_STATE_CANCELLING},
+                                                {"Finishing", OPAPI_STATE_FINISHING},
+                                                {"Operational", OPAPI_STATE_OPERATIONAL},
+                                                {"Offline", OPAPI_STATE_OFFLINE},
+                                                {"Closed", OPAPI_STATE_OFFLINE},
+                                                {"Printer is not operational", OPAPI_STATE_OFFLINE},
+                                                {"Error", OPAPI_STATE_ERROR},
+                                                {"Connecting", OPAPI_STATE_CONNECTING},
+                                                {"Opening", OPAPI_STATE_CONNECTING},
+                                                {"Detecting", OPAPI_STATE_CONNECTING},
+                                                {"Transferring file", OPAPI_STATE_TRANSFERRING}};
+
+static const octoprintName octoprintEstimates[] = {{"linear", OPAPI_ESTIMATE_LINEAR},
+                                                   {"analysis", OPAPI_ESTIMATE_ANALYSIS},
+                                                   {"average", OPAPI_ESTIMATE_AVERAGE},
+                                                   {"mixed-analysis", OPAPI_ESTIMATE_MIXED_ANALYSIS},
+                                                   {"mixed-average", OPAPI_ESTIMATE_MIXED_AVERAGE},
+                                                   {"estimate", OPAPI_ESTIMATE_ESTIMATE},
+                                                   {"genius", OPAPI_ESTIMATE_GENIUS}};
+
+static uint8_t lookupName(const octoprintName *names, size_t count, const char *text, bool prefix) {
+  if (text == NULL)
+    return 0;
+  for (size_t i = 0; i < count; i++) {
+    if (prefix ? strncmp(text, names[i].name, strlen(names[i].name)) == 0 : strcmp(text, names[i].name) == 0)
+      return names[i].value;
+  }
+  return 0;
+}
+
+static uint8_t stateFromText(const char *text) {
+  return lookupName(octoprintStates, sizeof(octoprintStates) / sizeof(octoprintStates[0]), text, true);
+}
+
+static int16_t tenths(JsonVariant temperature) {
+  float value = temperature.as<float>() * 10;
+  return (int16_t)(value >= 0 ? value + 0.5 : value - 0.5);
+}
+
+bool OctoprintApi::getPrinterSnapshot(printerSnapshot &snapshot) {
+  memset(&snapshot, 0, sizeof(snapshot));
+  if (!beginRequest(false, "/api/printer", NULL) || httpStatusCode < 200 || httpStatusCode > 299) {
+    // 409 while no printer is connected, which is a state like any other; its text is all that is needed of the body
+    char text[32];
+    readErrorText(text, sizeof(text));
+    snapshot.state = stateFromText(text);
+    return httpStatusCode == 409;
+  }
+
+  StaticJsonDocument<128> filter;
+  printerStatisticsFilter(filter);
+
+  StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+  DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+  endRequest();
+  if (error)
+    return false;
+
+  static const char *const flagNames[] = {"operational", "printing", "pausing", "paused",        "resuming", "cancelling",
+                                          "finishing",   "ready",    "error",   "closedOrError", "sdReady"};
+  JsonObject flags = root["state"]["flags"];
+  for (uint8_t i = 0; i < sizeof(flagNames) / sizeof(flagNames[0]); i++) {
+    if (flags[flagNames[i]] | false)
+      snapshot.flags |= 1 << i;  // same order as OPAPI_FLAG_*
+  }
+  snapshot.state = stateFromText(root["state"]["text"]);
+
+  for (JsonPair sensor : root["temperature"].as<JsonObject>()) {
+    const char *name = sensor.key().c_str();
+    JsonObject value = sensor.value();
+    if (strcmp(name, "bed") == 0) {
+      snapshot.bedActual = tenths(value["actual"]);
+      snapshot.bedTarget = tenths(value["target"]);
+      snapshot.flags |= OPAPI_FLAG_BED;
+    } else if (strcmp(name, "chamber") == 0) {
+      snapshot.chamberActual = tenths(value["actual"]);
+      snapshot.chamberTarget = tenths(value["target"]);
+      snapshot.flags |= OPAPI_FLAG_CHAMBER;
+    } else if (strncmp(name, "tool", 4) == 0 && name[4] >= '0' && name[4] <= '9') {
+      int tool = atoi(name + 4);
+      if (tool >= OPAPI_MAX_TOOLS)
+        continue;
+      snapshot.toolActual[tool] = tenths(value["actual"]);
+      snapshot.toolTarget[tool] = tenths(value["target"]);
+      if (tool >= snapshot.toolCount)
+        snapshot.toolCount = tool + 1;
     }
-    return true;
   }
-  return false;
+  return true;
+}
+
+bool OctoprintApi::getJobSnapshot(jobSnapshot &snapshot) {
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.printTimeLeft = -1;
+  if (!beginGetToOctoprint("/api/job"))
+    return false;
+
+  StaticJsonDocument<256> filter;
+  printJobFilter(filter);
+
+  StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+  DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+  endRequest();
+  if (error)
+    return false;
+
+  snapshot.state = stateFromText(root["state"]);
+
+  JsonObject file = root["job"]["file"];
+  snprintf(snapshot.fileName, sizeof(snapshot.fileName), "%s", (const char *)(file["name"] | ""));
+  snprintf(snapshot.filePath, sizeof(snapshot.filePath), "%s", (const char *)(file["path"] | ""));
+  const char *origin = file["origin"] | "";
+  if (strcmp(origin, "local") == 0)
+    snapshot.origin = OPAPI_ORIGIN_LOCAL;
+  else if (strcmp(origin, "sdcard") == 0)
+    snapshot.origin = OPAPI_ORIGIN_SDCARD;
+  snapshot.fileSize           = file["size"] | 0UL;
+  snapshot.fileDate           = file["date"] | 0UL;
+  snapshot.estimatedPrintTime = root["job"]["estimatedPrintTime"] | 0.0;
+
+  JsonObject progress    = root["progress"];
+  snapshot.completion    = (uint16_t)((progress["completion"] | 0.0) * 100 + 0.5);
+  snapshot.filepos       = progress["filepos"] | 0UL;
+  snapshot.printTime     = progress["printTime"] | 0UL;
+  snapshot.printTimeLeft = progress["printTimeLeft"] | -1L;
+  snapshot.estimate      = lookupName(octoprintEstimates, sizeof(octoprintEstimates) / sizeof(octoprintEstimates[0]),
+                                      progress["printTimeLeftOrigin"], false);
+  return true;
 }
 
 /** getOctoprintEndpointResults()
@@ -390,16 +1160,13 @@ String OctoprintApi::sendPostToOctoPrint(String command, const char *postData) {
  * 400 Bad Request – If the selected port or baudrate for a connect command are not part of the available options.
  * */
 bool OctoprintApi::octoPrintConnectionAutoConnect() {
-  sendPostToOctoPrint("/api/connection", "{\"command\": \"connect\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CONNECTION_CONNECT);
 }
 bool OctoprintApi::octoPrintConnectionDisconnect() {
-  sendPostToOctoPrint("/api/connection", "{\"command\": \"disconnect\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CONNECTION_DISCONNECT);
 }
 bool OctoprintApi::octoPrintConnectionFakeAck() {
-  sendPostToOctoPrint("/api/connection", "{\"command\": \"fake_ack\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_CONNECTION_FAKE_ACK);
 }
 
 /***** PRINT HEAD *****/
@@ -415,8 +1182,7 @@ bool OctoprintApi::octoPrintPrintHeadHome() {
   //   "command": "home",
   //   "axes": ["x", "y", "z"]
   // }
-  sendPostToOctoPrint("/api/printer/printhead", "{\"command\": \"home\",\"axes\": [\"x\", \"y\"]}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_PRINTHEAD_HOME);
 }
 
 bool OctoprintApi::octoPrintPrintHeadAbsoluteJog(double x, double y, double z, double f) {
@@ -426,7 +1192,10 @@ bool OctoprintApi::octoPrintPrintHeadRelativeJog(double x, double y, double z, d
 	return octoPrintPrintHeadJog(x,y,z,f,false);
 }
 	
-bool OctoprintApi::octoPrintPrintHeadJog(double x, double y, double z, double f,bool absolute) {
+/**
+ * Formats a jog command, axes that do not move and a zero speed (OctoPrint's default feedrate) are left out.
+ * */
+static int jogPayload(char *postData, size_t size, double x, double y, double z, double f, bool absolute) {
   //  {
   // "command": "jog",
   // "x": 10,
@@ -435,31 +1204,22 @@ bool OctoprintApi::octoPrintPrintHeadJog(double x, double y, double z, double f,
   // "absolute": false,
   // "speed": 30
   // }
-  char postData[1024];
-  char tmp[128];
-  postData[0] = '\0';
+  int length = snprintf(postData, size, "{\"command\": \"jog\"");
+  if (x != 0)
+    length += snprintf(postData + length, size - length, ", \"x\": %f", x);
+  if (y != 0)
+    length += snprintf(postData + length, size - length, ", \"y\": %f", y);
+  if (z != 0)
+    length += snprintf(postData + length, size - length, ", \"z\": %f", z);
+  if (f != 0)
+    length += snprintf(postData + length, size - length, ", \"speed\": %f", f);
+  length += snprintf(postData + length, size - length, absolute ? ", \"absolute\": true }" : ", \"absolute\": false }");
+  return length;
+}
 
-  strcat(postData, "{\"command\": \"jog\"");
-  if (x != 0) {
-    snprintf(tmp, 128, ", \"x\": %f", x);
-    strcat(postData, tmp);
-  }
-  if (y != 0) {
-    snprintf(tmp, 128, ", \"y\": %f", y);
-    strcat(postData, tmp);
-  }
-  if (z != 0) {
-    snprintf(tmp, 128, ", \"z\": %f", z);
-    strcat(postData, tmp);
-  }
-  if (f != 0) {
-    snprintf(tmp, 128, ", \"speed\": %f", f);
-    strcat(postData, tmp);
-  }
-  if(absolute){strcat(postData, ", \"absolute\": true");}
-  else{strcat(postData, ", \"absolute\": false");}
-	
-  strcat(postData, " }");
+bool OctoprintApi::octoPrintPrintHeadJog(double x, double y, double z, double f,bool absolute) {
+  char postData[POSTDATA_SIZE];
+  jogPayload(postData, POSTDATA_SIZE, x, y, z, f, absolute);
   if (_debug)
     Serial.println(postData);
 
@@ -483,17 +1243,30 @@ bool OctoprintApi::octoPrintSetBedTemperature(uint16_t t) {
   return (httpStatusCode == 204);
 }
 
-bool OctoprintApi::octoPrintSetTool0Temperature(uint16_t t) {
+bool OctoprintApi::octoPrintSetTool0Temperature(uint16_t t) { return octoPrintSetToolTemperature(0, t); }
+
+bool OctoprintApi::octoPrintSetTool1Temperature(uint16_t t) { return octoPrintSetToolTemperature(1, t); }
+
+bool OctoprintApi::octoPrintSetToolTemperature(uint8_t tool, uint16_t t) {
   char postData[POSTDATA_SIZE];
-  snprintf(postData, POSTDATA_SIZE, "{ \"command\": \"target\", \"targets\": { \"tool0\": %d } }", t);
+  snprintf(postData, POSTDATA_SIZE, "{ \"command\": \"target\", \"targets\": { \"tool%d\": %d } }", tool, t);
 
   sendPostToOctoPrint("/api/printer/tool", postData);
   return (httpStatusCode == 204);
 }
 
-bool OctoprintApi::octoPrintSetTool1Temperature(uint16_t t) {
+/** octoPrintSetToolTemperatures()
+ * Sets the targets of tool0 to tool(count - 1) in a single request, targets[i] going to tooli.
+ * */
+bool OctoprintApi::octoPrintSetToolTemperatures(const uint16_t *targets, uint8_t count) {
   char postData[POSTDATA_SIZE];
-  snprintf(postData, POSTDATA_SIZE, "{ \"command\": \"target\", \"targets\": { \"tool1\": %d } }", t);
+  int length = snprintf(postData, POSTDATA_SIZE, "{ \"command\": \"target\", \"targets\": {");
+  for (uint8_t i = 0; i < count && length < POSTDATA_SIZE; i++)
+    length += snprintf(postData + length, POSTDATA_SIZE - length, "%s \"tool%d\": %d", i ? "," : "", i, targets[i]);
+  if (length < POSTDATA_SIZE)
+    length += snprintf(postData + length, POSTDATA_SIZE - length, " } }");
+  if (count == 0 || length >= POSTDATA_SIZE)
+    return false;  // nothing to set, or more tools than fit in POSTDATA_SIZE
 
   sendPostToOctoPrint("/api/printer/tool", postData);
   return (httpStatusCode == 204);
@@ -509,41 +1282,102 @@ bool OctoprintApi::octoPrintSetTool1Temperature(uint16_t t) {
  * If no heated bed is configured for the currently selected printer profile, the resource will return an 409 Conflict.
  * */
 bool OctoprintApi::octoPrintGetPrinterBed() {
-  String response = sendGetToOctoprint("/api/printer/bed?history=true&limit=2");
+  if (!beginGetToOctoprint("/api/printer/bed?history=true&limit=2"))
+    return false;
+
+  StaticJsonDocument<128> filter;
+  filter["bed"]                = true;
+  filter["history"][0]["time"] = true;
+  filter["history"][0]["bed"]  = true;
 
   StaticJsonDocument<JSONDOCUMENT_SIZE> root;
-  if (!deserializeJson(root, response)) {
-    if (root.containsKey("bed")) {
-      printerBed.printerBedTempActual = root["bed"]["actual"];
-      printerBed.printerBedTempOffset = root["bed"]["offset"];
-      printerBed.printerBedTempTarget = root["bed"]["target"];
-    }
-    if (root.containsKey("history")) {
-      printerBed.printerBedTempHistoryTimestamp = root["history"][0]["time"];
-      printerBed.printerBedTempHistoryActual    = root["history"][0]["bed"]["actual"];
-    }
+  DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+  endRequest();
+
+  if (!error) {
+    parsePrinterBed(root.as<JsonObject>());
     return true;
   }
   return false;
 }
 
-/***** SD FUNCTIONS *****/
-/*
+/**
+ * The bed endpoint and the temperature part of /api/printer share the same layout, so this fills printerBed from either.
+ * */
+void OctoprintApi::parsePrinterBed(JsonObject temperature) {
+  if (temperature.containsKey("bed")) {
+    printerBed.printerBedTempActual = temperature["bed"]["actual"];
+    printerBed.printerBedTempOffset = temperature["bed"]["offset"];
+    printerBed.printerBedTempTarget = temperature["bed"]["target"];
+  }
+  if (temperature.containsKey("history")) {
+    printerBed.printerBedTempHistoryTimestamp = temperature["history"][0]["time"];
+    printerBed.printerBedTempHistoryActual    = temperature["history"][0]["bed"]["actual"];
+  }
+}
+
+/** refreshAll()
+ * Fills printerStats (including sdReady), printerBed and printJob in two requests over one kept-alive connection,
+ * instead of the four separate connections of getPrinterStatistics(), octoPrintGetPrinterBed(), octoPrintGetPrinterSD()
+ * and getPrintJob(). printerStats and printerBed come from the same /api/printer snapshot, so they always agree.
+ * */
+bool OctoprintApi::refreshAll() {
+  bool keepAlive = _keepAlive;
+  _keepAlive     = true;
+
+  bool printer = false;
+  if (beginGetToOctoprint("/api/printer?history=true&limit=2")) {
+    // Only the sensors parseTemperatures() keeps and the one history value printerBed has room for: every sample
+    // carries all sensors, which would not fit in the document with a few tools and a chamber.
+    StaticJsonDocument<384> filter;
+    filter["state"]        = true;
+    JsonObject temperature = filter.createNestedObject("temperature");
+    temperature["bed"]     = true;
+    temperature["chamber"] = true;
+    char tool[8];
+    for (int i = 0; i < OPAPI_MAX_TOOLS; i++) {
+      snprintf(tool, sizeof(tool), "tool%d", i);
+      temperature[tool] = true;
+    }
+    temperature["history"][0]["time"]          = true;
+    temperature["history"][0]["bed"]["actual"] = true;
+
+    StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+    DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+    endRequest();
+
+    if (!error) {
+      parsePrinterStatistics(root);
+      parsePrinterBed(root["temperature"]);
+      _printerStatisticsCache.valid = false;  // printerStats no longer matches the validators of /api/printer
+      printer = true;
+    } else
+      printerStats.printerStateoperational = false;
+  } else
+    printer = printerStatisticsFailed();
+
+  bool job = getPrintJob();
+
+  _keepAlive = keepAlive;
+  if (!keepAlive)
+    closeConnection();
+  return printer && job;
+}
+
+/***** SD FUNCTIONS *****/
+/*
  * http://docs.octoprint.org/en/master/api/printer.html#issue-an-sd-command
  * SD commands allow initialization, refresh and release of the printer’s SD card (if available).
  * Available commands are: init, refresh, release
 */
 bool OctoprintApi::octoPrintPrinterSDInit() {
-  sendPostToOctoPrint("/api/printer/sd", "{\"command\": \"init\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_SD_INIT);
 }
 bool OctoprintApi::octoPrintPrinterSDRefresh() {
-  sendPostToOctoPrint("/api/printer/sd", "{\"command\": \"refresh\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_SD_REFRESH);
 }
 bool OctoprintApi::octoPrintPrinterSDRelease() {
-  sendPostToOctoPrint("/api/printer/sd", "{\"command\": \"release\"}");
-  return (httpStatusCode == 204);
+  return sendCommand(OPAPI_SD_RELEASE);
 }
 
 /*
@@ -553,11 +1387,17 @@ If SD support has been disabled in OctoPrint’s settings, a 404 Not Found is re
 Returns a 200 OK with an SD State Response in the body upon success.
 */
 bool OctoprintApi::octoPrintGetPrinterSD() {
-  String command  = "/api/printer/sd";
-  String response = sendGetToOctoprint(command);
+  if (!beginGetToOctoprint("/api/printer/sd"))
+    return false;
+
+  StaticJsonDocument<16> filter;
+  filter["ready"] = true;
 
   StaticJsonDocument<JSONDOCUMENT_SIZE> root;
-  if (!deserializeJson(root, response)) {
+  DeserializationError error = deserializeJson(root, _body, DeserializationOption::Filter(filter));
+  endRequest();
+
+  if (!error) {
     bool printerStatesdReady         = root["ready"];
     printerStats.printerStatesdReady = printerStatesdReady;
     return true;
@@ -565,6 +1405,39 @@ bool OctoprintApi::octoPrintGetPrinterSD() {
   return false;
 }
 
+/** escapeJson()
+ * Copies text into out as the inside of a JSON string, escaping quotes, backslashes and control characters.
+ * Works like snprintf: writes at most size - 1 characters plus the terminator and returns the full escaped length.
+ * */
+static size_t escapeJson(char *out, size_t size, const char *text) {
+  size_t length = 0;
+  for (; *text; text++) {
+    char escaped[7];
+    uint8_t c = *text;
+    if (c == '"' || c == '\\')
+      snprintf(escaped, sizeof(escaped), "\\%c", c);
+    else if (c == '\n')
+      snprintf(escaped, sizeof(escaped), "\\n");
+    else if (c == '\r')
+      snprintf(escaped, sizeof(escaped), "\\r");
+    else if (c == '\t')
+      snprintf(escaped, sizeof(escaped), "\\t");
+    else if (c < 0x20)
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+    else {
+      escaped[0] = c;
+      escaped[1] = '\0';
+    }
+    for (char *e = escaped; *e; e++, length++) {
+      if (length + 1 < size)
+        out[length] = *e;
+    }
+  }
+  if (size > 0)
+    out[length < size ? length : size - 1] = '\0';
+  return length;
+}
+
 /***** COMMANDS *****/
 /*
 http://docs.octoprint.org/en/master/api/printer.html#send-an-arbitrary-command-to-the-printer
@@ -572,47 +1445,1363 @@ Sends any command to the printer via the serial interface. Should be used with s
 If successful returns a 204 No Content and an empty body.
 */
 bool OctoprintApi::octoPrintPrinterCommand(char *gcodeCommand) {
-  String command = "/api/printer/command";
-  char postData[POSTDATA_GCODE_SIZE];
+  // Short commands are built on the stack, longer ones on the heap rather than being cut off.
+  char buffer[POSTDATA_GCODE_SIZE];
+  size_t size    = escapeJson(NULL, 0, gcodeCommand) + 16;  // {"command": ""} and the terminator
+  char *postData = size <= sizeof(buffer) ? buffer : new char[size];
 
-  postData[0] = '\0';
-  snprintf(postData, POSTDATA_GCODE_SIZE, "{\"command\": \"%s\"}", gcodeCommand);
+  int length = snprintf(postData, size, "{\"command\": \"");
+  length += escapeJson(postData + length, size - length, gcodeCommand);
+  snprintf(postData + length, size - length, "\"}");
 
-  sendPostToOctoPrint(command, postData);
+  sendPostToOctoPrint("/api/printer/command", postData);
 
+  if (postData != buffer)
+    delete[] postData;
   return (httpStatusCode == 204);
 }
 
+/***** COMMAND BATCH *****/
+/**
+ * Collects G-code lines and sends them together as one {"commands": [...]} POST, so a macro costs one round trip
+ * instead of one per line. add() sends the batch first whenever the next line would not fit in
+ * OPAPI_COMMAND_BATCH_SIZE, a line too long for the buffer on its own goes out by itself. Call flush() to send the rest.
+ * Nothing is ever truncated.
+ * */
+OctoprintCommandBatch::OctoprintCommandBatch(OctoprintApi &api) : _api(api) { clear(); }
+
+void OctoprintCommandBatch::clear() {
+  _length = snprintf(_buffer, sizeof(_buffer), "{\"commands\": [");
+  _count  = 0;
+}
+
+uint8_t OctoprintCommandBatch::count() { return _count; }
+
+bool OctoprintCommandBatch::add(const char *command) {
+  size_t needed = escapeJson(NULL, 0, command) + (_count ? 4 : 2);  // the quotes, after the first line also ", "
+  bool success  = true;
+  if (_length + needed + 2 >= sizeof(_buffer))  // room for the closing "]}" and the terminator
+    success = flush();
+  if (_length + needed + 2 >= sizeof(_buffer))
+    return _api.octoPrintPrinterCommand((char *)command) && success;
+
+  _length += snprintf(_buffer + _length, sizeof(_buffer) - _length, _count ? ", \"" : "\"");
+  _length += escapeJson(_buffer + _length, sizeof(_buffer) - _length, command);
+  _length += snprintf(_buffer + _length, sizeof(_buffer) - _length, "\"");
+  _count++;
+  return success;
+}
+
+/** flush()
+ * Sends what has been added so far, true on the 204 No Content OctoPrint answers with (or when there was nothing to send).
+ * */
+bool OctoprintCommandBatch::flush() {
+  if (_count == 0)
+    return true;
+  snprintf(_buffer + _length, sizeof(_buffer) - _length, "]}");
+  _api.sendPostToOctoPrint("/api/printer/command", _buffer);
+  clear();
+  return (_api.httpStatusCode == 204);
+}
+
+/***** JOG COALESCING *****/
+/**
+ * Turns a stream of small relative moves, e.g. from a rotary encoder, into at most one jog every interval ms.
+ * move() only adds to the pending X/Y/Z offsets, poll() sends them as a single merged jog through the asynchronous API
+ * once the previous one has been answered, so the head follows the knob instead of working through a queue of
+ * blocking requests. Offsets that OctoPrint refuses (409 while printing) are dropped rather than replayed later.
+ * */
+OctoprintJogger::OctoprintJogger(OctoprintApi &api) : _api(api) {
+  _interval = OPAPI_JOG_INTERVAL;
+  _speed    = 0;
+  _lastJog  = 0;
+  cancel();
+}
+
+void OctoprintJogger::move(float x, float y, float z) {
+  _x += x;
+  _y += y;
+  _z += z;
+}
+
+/** setInterval()
+ * Minimum time between two jogs in ms, i.e. the highest rate they are sent at.
+ * */
+void OctoprintJogger::setInterval(unsigned long interval) { _interval = interval; }
+
+/** setSpeed()
+ * Feedrate of the jogs in mm/min, 0 leaves it to OctoPrint's configured movement speed.
+ * */
+void OctoprintJogger::setSpeed(float speed) { _speed = speed; }
+
+bool OctoprintJogger::pending() { return _x != 0 || _y != 0 || _z != 0; }
+
+void OctoprintJogger::cancel() { _x = _y = _z = 0; }
+
+/** poll()
+ * Call from loop(), it also advances the request of the OctoprintApi. Returns true when a jog was sent.
+ * */
+bool OctoprintJogger::poll() {
+  _api.poll();
+  if (!pending() || _api.requestInProgress() || millis() - _lastJog < _interval)
+    return false;
+
+  char postData[POSTDATA_SIZE];
+  jogPayload(postData, POSTDATA_SIZE, _x, _y, _z, _speed, false);
+  if (!_api.beginSendPostToOctoPrint("/api/printer/printhead", postData))
+    return false;
+  cancel();
+  _lastJog = millis();
+  return true;
+}
+
+/***** ASYNCHRONOUS REQUESTS *****/
+/**
+ * Non-blocking versions of the getters. begin...() sends the request and returns straight away, poll() must then be
+ * called from loop() and advances the response by at most OPAPI_POLL_BUDGET bytes per call. When the response is
+ * complete the matching struct (printJob, printerStats) is filled in and the callback fires with the outcome.
+ * Only one request can be in flight per OctoprintApi, and connect() itself still blocks on most Arduino clients,
+ * so pair this with setKeepAlive(true) to keep the connection open between polls.
+ * */
+bool OctoprintApi::beginGetPrintJob(OctoprintCallback callback) {
+  return beginAsyncRequest(false, "/api/job", NULL, OPAPI_ASYNC_PRINT_JOB, callback);
+}
+
+bool OctoprintApi::beginGetPrinterStatistics(OctoprintCallback callback) {
+  return beginAsyncRequest(false, "/api/printer", NULL, OPAPI_ASYNC_PRINTER_STATISTICS, callback);
+}
+
+/** requestChanged()
+ * Whether the last asynchronous getter actually changed its struct, false after a 304 or a byte-identical body.
+ * */
+bool OctoprintApi::requestChanged() { return _asyncChanged; }
+
+bool OctoprintApi::beginSendPostToOctoPrint(String command, const char *postData, OctoprintCallback callback) {
+  return beginAsyncRequest(true, command, postData, OPAPI_ASYNC_RAW, callback);
+}
+
+bool OctoprintApi::requestInProgress() { return _asyncState != OPAPI_ASYNC_IDLE; }
+
+/** requestSucceeded()
+ * Outcome of the last asynchronous request, for callers that poll() without a callback.
+ * */
+bool OctoprintApi::requestSucceeded() { return _asyncSuccess; }
+
+/** allocateBodyBuffer()
+ * Only instances that need the body buffer pay for it: the non-blocking API and updatePrintJob()/updatePrinterStatistics().
+ * */
+bool OctoprintApi::allocateBodyBuffer() {
+  if (_asyncBuffer == NULL)
+    _asyncBuffer = new char[OPAPI_ASYNC_BUFFER_SIZE];
+  return _asyncBuffer != NULL;
+}
+
+bool OctoprintApi::beginAsyncRequest(bool post, String command, const char *data, uint8_t kind, OctoprintCallback callback) {
+  if (_asyncState != OPAPI_ASYNC_IDLE)
+    return false;
+  if (!allocateBodyBuffer())
+    return false;
+
+  // The payload is kept for a possible stale connection retry, the buffer is only reused for the body after that.
+  _asyncHasData = data != NULL;
+  if (_asyncHasData) {
+    size_t length = strlen(data);
+    if (length >= OPAPI_ASYNC_BUFFER_SIZE)
+      return false;
+    memcpy(_asyncBuffer, data, length + 1);
+  }
+  _asyncPost     = post;
+  _asyncCommand  = command;
+  _asyncKind     = kind;
+  _asyncCallback = callback;
+  _asyncReused   = false;
+
+  if (!sendRequest(post, command.c_str(), _asyncHasData ? _asyncBuffer : NULL, _asyncReused, asyncCache())) {
+    httpStatusCode = -1;
+    metricsEnd();  // counts the connect failure, an open record would swallow the next request's
+    return false;
+  }
+  _asyncStart = millis();
+  _asyncState = OPAPI_ASYNC_HEADERS;
+  return true;
+}
+
+/** poll()
+ * Advances the request started with one of the begin...() calls, returns true while it is still in progress.
+ * */
+bool OctoprintApi::poll() {
+  if (_asyncState == OPAPI_ASYNC_IDLE)
+    return false;
+
+  if (millis() - _asyncStart >= OPAPI_TIMEOUT) {
+    if (_debug)
+      Serial.println("OctoprintApi::poll() request timed out");
+    httpStatusCode = _response.finished() ? httpStatusCode : -1;
+    closeClient();
+    finishAsync(false);
+    return false;
+  }
+
+  if (_asyncState == OPAPI_ASYNC_HEADERS) {
+    if (!readResponseHeaders(OPAPI_POLL_BUDGET)) {
+      if (_asyncReused && !_response.started() && !_client->connected()) {
+        if (_debug)
+          Serial.println(_asyncPost ? "kept-alive connection closed after a POST, not sending it again" : "kept-alive connection was stale, reconnecting");
+        closeClient();
+        if (_asyncPost || !sendRequest(_asyncPost, _asyncCommand.c_str(), _asyncHasData ? _asyncBuffer : NULL, _asyncReused, asyncCache())) {
+          httpStatusCode = -1;
+          finishAsync(false);
+          return false;
+        }
+        _asyncStart = millis();
+      }
+      return true;
+    }
+    startBody();
+    _asyncLength   = 0;
+    _asyncOverflow = false;
+    _asyncState    = OPAPI_ASYNC_BODY;
+  }
+
+  int budget = OPAPI_POLL_BUDGET;
+  int c;
+  while (budget-- > 0 && (c = _body.read()) >= 0) {
+    if (_asyncLength < OPAPI_ASYNC_BUFFER_SIZE - 1)
+      _asyncBuffer[_asyncLength++] = c;
+    else
+      _asyncOverflow = true;
+  }
+  if (!_body.finished())
+    return true;
+  _asyncBuffer[_asyncLength] = '\0';
+  _asyncState                = OPAPI_ASYNC_IDLE;
+  endRequest();
+
+  responseCache *cache = asyncCache();
+  bool success         = httpStatusCode >= 200 && httpStatusCode <= 299 && !_asyncOverflow;
+  _asyncChanged        = success;
+  if (cache != NULL && httpStatusCode == 304) {
+    success       = true;
+    _asyncChanged = false;
+  } else if (!success) {
+    httpErrorBody = _asyncBuffer;
+    if (_asyncKind == OPAPI_ASYNC_PRINTER_STATISTICS)
+      success = _asyncChanged = printerStatisticsFailed();
+  } else if (cache != NULL && cache->valid && cache->bodyHash == _body.hash()) {
+    _asyncChanged = false;  // byte-identical body, no need to even deserialize it
+  } else if (_asyncKind == OPAPI_ASYNC_PRINT_JOB) {
+    StaticJsonDocument<256> filter;
+    printJobFilter(filter);
+    StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+    success = !deserializeJson(root, _asyncBuffer, _asyncLength, DeserializationOption::Filter(filter));
+    if (success) {
+      updateCache(*cache, _body.hash());
+      parsePrintJob(root.as<JsonObject>());
+    }
+  } else if (_asyncKind == OPAPI_ASYNC_PRINTER_STATISTICS) {
+    StaticJsonDocument<128> filter;
+    printerStatisticsFilter(filter);
+    StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+    success = !deserializeJson(root, _asyncBuffer, _asyncLength, DeserializationOption::Filter(filter));
+    if (success) {
+      updateCache(*cache, _body.hash());
+      parsePrinterStatistics(root);
+    } else
+      printerStats.printerStateoperational = false;
+  }
+  if (!success)
+    _asyncChanged = false;
+  finishAsync(success);
+  return false;
+}
+
+responseCache *OctoprintApi::asyncCache() {
+  if (_asyncKind == OPAPI_ASYNC_PRINT_JOB)
+    return &_printJobCache;
+  if (_asyncKind == OPAPI_ASYNC_PRINTER_STATISTICS)
+    return &_printerStatisticsCache;
+  return NULL;
+}
+
+void OctoprintApi::finishAsync(bool success) {
+  metricsEnd();  // already done by endRequest() unless the request never got that far
+  OctoprintCallback callback = _asyncCallback;
+  _asyncState                = OPAPI_ASYNC_IDLE;
+  _asyncSuccess              = success;
+  _asyncCallback             = NULL;
+  if (callback)
+    callback(this, success);
+}
+
 /***** GENERAL FUNCTIONS *****/
 
+/***** METRICS *****/
+#ifdef OPAPI_METRICS
 /**
- * Close the client
+ * Build with OPAPI_METRICS defined (e.g. -DOPAPI_METRICS in the build flags) to have every request recorded in
+ * metrics, per endpoint: counters, bytes and fixed bucket histograms of the connect, first byte, parse and total
+ * times. Without it none of this is compiled in and the hooks are empty inline functions.
  * */
-void OctoprintApi::closeClient() { _client->stop(); }
+static const char *const metricsPrefixes[OPAPI_METRICS_ENDPOINTS - 1] = {"/api/job", "/api/printer", "/api/files", "/api/connection",
+                                                                          "/api/system", "/api/version"};
+static const char *const metricsNames[OPAPI_METRICS_ENDPOINTS]        = {"job",    "printer", "files", "connection",
+                                                                          "system", "version", "other"};
+static const uint16_t metricsBuckets[OPAPI_METRICS_BUCKETS - 1]       = {10, 25, 50, 100, 250, 500, 1000, 2500};
+
+static void metricsRecord(uint16_t *histogram, unsigned long ms) {
+  uint8_t bucket = 0;
+  while (bucket < OPAPI_METRICS_BUCKETS - 1 && ms > metricsBuckets[bucket])
+    bucket++;
+  if (histogram[bucket] < 0xFFFF)
+    histogram[bucket]++;
+}
+
+void OctoprintApi::resetMetrics() { memset(&metrics, 0, sizeof(metrics)); }
+
+void OctoprintApi::metricsBegin(const char *command) {
+  if (_metricsActive)
+    return;  // a retry on a fresh connection still counts as the same request
+  _metricsActive   = true;
+  _metricsEndpoint = OPAPI_METRICS_ENDPOINTS - 1;
+  for (uint8_t i = 0; i < OPAPI_METRICS_ENDPOINTS - 1; i++) {
+    size_t length = strlen(metricsPrefixes[i]);
+    if (strncmp(command, metricsPrefixes[i], length) == 0 && (command[length] == '\0' || command[length] == '/' || command[length] == '?')) {
+      _metricsEndpoint = i;
+      break;
+    }
+  }
+  _metricsStart     = millis();
+  _metricsConnect   = -1;
+  _metricsFirstByte = -1;
+  _metricsHeaders   = -1;
+}
+
+void OctoprintApi::metricsConnected() {
+  if (_metricsActive)
+    _metricsConnect = millis() - _metricsStart;
+}
+
+void OctoprintApi::metricsFirstByte() {
+  if (_metricsActive && _metricsFirstByte < 0)
+    _metricsFirstByte = millis() - _metricsStart;
+}
+
+void OctoprintApi::metricsHeaders() {
+  if (_metricsActive)
+    _metricsHeaders = millis() - _metricsStart;
+}
+
+void OctoprintApi::metricsSent(size_t bytes) {
+  if (_metricsActive)
+    metrics.endpoints[_metricsEndpoint].bytesOut += bytes;
+}
+
+void OctoprintApi::metricsReceived(size_t bytes) {
+  if (_metricsActive)
+    metrics.endpoints[_metricsEndpoint].bytesIn += bytes;
+}
+
+void OctoprintApi::metricsEnd() {
+  if (!_metricsActive)
+    return;
+  _metricsActive = false;
+
+  octoprintEndpointMetrics &endpoint = metrics.endpoints[_metricsEndpoint];
+  unsigned long total                = millis() - _metricsStart;
+  endpoint.requests++;
+  if (_metricsConnect < 0)
+    endpoint.connectFailures++;
+  else
+    metricsRecord(endpoint.connectTime, _metricsConnect);
+  if (_metricsFirstByte >= 0)
+    metricsRecord(endpoint.firstByteTime, _metricsFirstByte - (_metricsConnect > 0 ? _metricsConnect : 0));
+  if (_metricsHeaders >= 0) {
+    metricsRecord(endpoint.parseTime, total - _metricsHeaders);
+    endpoint.bytesIn += _body.received();
+  } else if (_metricsConnect >= 0)
+    endpoint.timeouts++;
+  metricsRecord(endpoint.totalTime, total);
+
+  if (httpStatusCode >= 400 && httpStatusCode <= 499)
+    endpoint.clientErrors++;
+  else if (httpStatusCode >= 500 && httpStatusCode <= 599)
+    endpoint.serverErrors++;
+  if ((httpStatusCode < 200 || httpStatusCode > 299) && httpStatusCode != 304)
+    endpoint.lastError = httpStatusCode > 0 ? httpStatusCode : -1;
+}
 
+static void printHistogram(Print &out, const char *name, const uint16_t *histogram) {
+  out.print(",\"");
+  out.print(name);
+  out.print("\":[");
+  for (uint8_t i = 0; i < OPAPI_METRICS_BUCKETS; i++) {
+    if (i)
+      out.print(',');
+    out.print(histogram[i]);
+  }
+  out.print(']');
+}
+
+/** printMetrics()
+ * Writes metrics as JSON to out (Serial, a WiFiClient, a String...), leaving out endpoints that were never used.
+ * bucketsMs holds the upper bound of every histogram bucket but the last, which counts everything slower.
+ * */
+void OctoprintApi::printMetrics(Print &out) {
+  out.print("{\"bucketsMs\":[");
+  for (uint8_t i = 0; i < OPAPI_METRICS_BUCKETS - 1; i++) {
+    if (i)
+      out.print(',');
+    out.print(metricsBuckets[i]);
+  }
+  out.print("],\"endpoints\":{");
+  bool first = true;
+  for (uint8_t i = 0; i < OPAPI_METRICS_ENDPOINTS; i++) {
+    octoprintEndpointMetrics &endpoint = metrics.endpoints[i];
+    if (endpoint.requests == 0)
+      continue;
+    if (!first)
+      out.print(',');
+    first = false;
+    out.print('"');
+    out.print(metricsNames[i]);
+    out.print("\":{\"requests\":");
+    out.print(endpoint.requests);
+    out.print(",\"connectFailures\":");
+    out.print(endpoint.connectFailures);
+    out.print(",\"timeouts\":");
+    out.print(endpoint.timeouts);
+    out.print(",\"clientErrors\":");
+    out.print(endpoint.clientErrors);
+    out.print(",\"serverErrors\":");
+    out.print(endpoint.serverErrors);
+    out.print(",\"lastError\":");
+    out.print(endpoint.lastError);
+    out.print(",\"bytesOut\":");
+    out.print(endpoint.bytesOut);
+    out.print(",\"bytesIn\":");
+    out.print(endpoint.bytesIn);
+    printHistogram(out, "connect", endpoint.connectTime);
+    printHistogram(out, "firstByte", endpoint.firstByteTime);
+    printHistogram(out, "parse", endpoint.parseTime);
+    printHistogram(out, "total", endpoint.totalTime);
+    out.print('}');
+  }
+  out.print("}}");
+}
+#endif
+
+/***** BODY STREAM *****/
 /**
- * Extract the HTTP header response code. Used for error reporting - will print in serial monitor any non 200 response codes (i.e. if something has gone wrong!).
- * Thanks Brian for the start of this function, and the chuckle of watching you realise on a live stream that I didn't use the response code at that time! :)
+ * Stream view of the response body. Reads stop where the body ends (Content-Length) or when the server hangs up,
+ * which lets ArduinoJson deserialize straight off the socket without a String copy in between.
  * */
-int OctoprintApi::extractHttpCode(String statusCode, String body) {
-  if (_debug) {
-    Serial.print("\nStatus code to extract: ");
-    Serial.println(statusCode);
-  }
-  int firstSpace = statusCode.indexOf(" ");
-  int lastSpace  = statusCode.lastIndexOf(" ");
-  if (firstSpace > -1 && lastSpace > -1 && firstSpace != lastSpace) {
-    String statusCodeALL     = statusCode.substring(firstSpace + 1);             //"400 BAD REQUEST"
-    String statusCodeExtract = statusCode.substring(firstSpace + 1, lastSpace);  //May end up being e.g. "400 BAD"
-    int statusCodeInt        = statusCodeExtract.toInt();                        //Converts to "400" integer - i.e. strips out rest of text characters "fix"
-    if (_debug and statusCodeInt != 200 and statusCodeInt != 201 and statusCodeInt != 202 and statusCodeInt != 204) {
-      Serial.print("\nSERVER RESPONSE CODE: " + String(statusCodeALL));
-      if (body != "")
-        Serial.println(" - " + body);
-      else
-        Serial.println();
+void OctoprintBodyStream::begin(Client *client, long length, bool chunked, OctoprintContentEncoding encoding) {
+  _client    = client;
+  _length    = chunked ? -1 : length;
+  _remaining = _length;
+  _chunked   = chunked;
+  _hash      = 2166136261UL;
+  _received  = 0;
+  if (chunked)
+    _chunks.reset();
+#ifdef OPAPI_GZIP
+  _compressed = encoding == OPAPI_ENCODING_GZIP || encoding == OPAPI_ENCODING_DEFLATE;
+  _next       = -1;
+  if (_compressed && _inflate == NULL)
+    _inflate = new OctoprintInflater();  // window and tables only for a server that actually compresses
+  if (_compressed && _inflate != NULL)
+    _inflate->begin(encoding);
+#endif
+  setTimeout(OPAPI_TIMEOUT);
+}
+
+#ifdef OPAPI_GZIP
+OctoprintBodyStream::~OctoprintBodyStream() { delete _inflate; }
+#endif
+
+long OctoprintBodyStream::length() { return _length; }
+
+/**
+ * FNV-1a hash of every body byte read so far (after decompression), cheap enough to tell whether a response changed
+ * since last time.
+ * */
+uint32_t OctoprintBodyStream::hash() { return _hash; }
+
+/**
+ * Body bytes read so far as they came over the wire, without the chunked framing.
+ * */
+long OctoprintBodyStream::received() { return _received; }
+
+/**
+ * True when the end of the body can be found without the server closing the connection.
+ * */
+bool OctoprintBodyStream::framed() { return _chunked || _length >= 0; }
+
+bool OctoprintBodyStream::finished() {
+#ifdef OPAPI_GZIP
+  if (_compressed) {
+    if (peek() >= 0)
+      return false;
+    if (_inflate == NULL || _inflate->done() || _inflate->failed()) {
+      while (rawRead() >= 0)
+        ;  // gzip/zlib trailer, or the rest of a body that could not be inflated
     }
-    return statusCodeInt;
+  }
+#endif
+  return rawFinished();
+}
+
+bool OctoprintBodyStream::rawFinished() {
+  if (_chunked) {
+    skipFraming();
+    if (_chunks.finished())
+      return true;
+  } else if (_remaining >= 0)
+    return _remaining == 0;
+  return !_client->available() && !_client->connected();
+}
+
+/**
+ * Consume chunk sizes and separators until the next byte waiting on the socket is body data.
+ * */
+void OctoprintBodyStream::skipFraming() {
+  while (!_chunks.wantsData() && !_chunks.finished() && _client->available())
+    _chunks.framing(_client->read());
+}
+
+int OctoprintBodyStream::available() {
+#ifdef OPAPI_GZIP
+  if (_compressed)
+    return peek() >= 0 ? 1 : 0;
+#endif
+  if (_chunked) {
+    skipFraming();
+    if (!_chunks.wantsData())
+      return 0;
+    int n = _client->available();
+    return n > _chunks.remaining() ? _chunks.remaining() : n;
+  }
+  if (_remaining == 0)
+    return 0;
+  int n = _client->available();
+  if (_remaining > 0 && n > _remaining)
+    n = _remaining;
+  return n;
+}
+
+int OctoprintBodyStream::read() {
+  int c;
+#ifdef OPAPI_GZIP
+  if (_compressed) {
+    c     = _next >= 0 ? _next : inflate();
+    _next = -1;
   } else
+#endif
+    c = rawRead();
+  if (c >= 0)
+    _hash = (_hash ^ (uint8_t)c) * 16777619UL;
+  if (debug && c >= 0)
+    Serial.print((char)c);
+  return c;
+}
+
+#ifdef OPAPI_GZIP
+/**
+ * Next inflated byte, -1 when there was no memory for the decoder, which fails the body like a malformed one.
+ * */
+int OctoprintBodyStream::inflate() { return _inflate != NULL ? _inflate->read(*this) : -1; }
+#endif
+
+/**
+ * Next byte of the body as sent, i.e. still compressed when it is.
+ * */
+int OctoprintBodyStream::rawRead() {
+  if (_chunked) {
+    skipFraming();
+    if (!_chunks.wantsData())
+      return -1;
+  } else if (_remaining == 0)
+    return -1;
+  if (!_client->available())
+    return -1;
+  int c = _client->read();
+  if (c >= 0) {
+    if (_chunked)
+      _chunks.data();
+    else if (_remaining > 0)
+      _remaining--;
+    _received++;
+  }
+  return c;
+}
+
+int OctoprintBodyStream::peek() {
+#ifdef OPAPI_GZIP
+  if (_compressed) {
+    if (_next < 0)
+      _next = inflate();
+    return _next;
+  }
+#endif
+  if (_chunked) {
+    skipFraming();
+    if (!_chunks.wantsData())
+      return -1;
+  } else if (_remaining == 0)
+    return -1;
+  if (!_client->available())
     return -1;
+  return _client->peek();
+}
+
+size_t OctoprintBodyStream::write(uint8_t) { return 0; }
+
+void OctoprintBodyStream::flush() {}
+
+/**
+ * Print that only keeps an FNV-1a hash of what is written to it, e.g. to tell whether part of a JSON document changed.
+ * */
+size_t OctoprintHashPrint::write(uint8_t c) {
+  _hash = (_hash ^ c) * 16777619UL;
+  return 1;
+}
+
+uint32_t OctoprintHashPrint::hash() { return _hash; }
+
+#ifdef OPAPI_GZIP
+/***** INFLATE *****/
+/**
+ * Streaming gzip/zlib/deflate decoder (RFC 1950-1952) for compressed responses. It is pulled one byte at a time by
+ * OctoprintBodyStream, takes compressed bytes off the socket only as it needs them and stops wherever the input runs
+ * dry, so the JSON parser reads it like any other body and the decompressed body never exists in full.
+ * The only history kept is an OPAPI_INFLATE_WINDOW byte window, a response referring further back than that fails.
+ * The gzip CRC is not checked, a damaged body makes the JSON parser fail instead.
+ * */
+enum {
+  OPAPI_INFLATE_GZIP_HEADER,
+  OPAPI_INFLATE_GZIP_EXTRA_LENGTH,
+  OPAPI_INFLATE_SKIP,
+  OPAPI_INFLATE_SKIP_STRING,
+  OPAPI_INFLATE_ZLIB_HEADER,
+  OPAPI_INFLATE_BLOCK,
+  OPAPI_INFLATE_STORED_LENGTH,
+  OPAPI_INFLATE_STORED,
+  OPAPI_INFLATE_TABLE_SIZES,
+  OPAPI_INFLATE_CODE_LENGTHS,
+  OPAPI_INFLATE_LENGTHS,
+  OPAPI_INFLATE_LENGTHS_REPEAT,
+  OPAPI_INFLATE_CODES,
+  OPAPI_INFLATE_LENGTH_EXTRA,
+  OPAPI_INFLATE_DISTANCE,
+  OPAPI_INFLATE_DISTANCE_EXTRA,
+  OPAPI_INFLATE_COPY,
+  OPAPI_INFLATE_DONE,
+  OPAPI_INFLATE_ERROR
+};
+
+static const uint16_t inflateLengthBase[29] PROGMEM    = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t inflateLengthExtra[29] PROGMEM    = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t inflateDistanceBase[30] PROGMEM  = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                          33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                          1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t inflateDistanceExtra[30] PROGMEM  = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                          6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t inflateCodeLengthOrder[19] PROGMEM = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/**
+ * Canonical Huffman table from code lengths: counts[] codes per length, symbols[] ordered by code.
+ * */
+static bool inflateTable(uint16_t *counts, uint16_t *symbols, const uint8_t *lengths, uint16_t n) {
+  uint16_t offsets[16];
+  memset(counts, 0, 16 * sizeof(uint16_t));
+  for (uint16_t i = 0; i < n; i++)
+    counts[lengths[i]]++;
+  int left = 1;
+  for (uint8_t length = 1; length < 16; length++) {
+    left = (left << 1) - counts[length];
+    if (left < 0)
+      return false;  // more codes than lengths allow
+  }
+  offsets[1] = 0;
+  for (uint8_t length = 1; length < 15; length++)
+    offsets[length + 1] = offsets[length] + counts[length];
+  for (uint16_t i = 0; i < n; i++) {
+    if (lengths[i])
+      symbols[offsets[lengths[i]]++] = i;
+  }
+  return true;
+}
+
+void OctoprintInflater::begin(OctoprintContentEncoding encoding) {
+  _state    = encoding == OPAPI_ENCODING_GZIP ? OPAPI_INFLATE_GZIP_HEADER : OPAPI_INFLATE_ZLIB_HEADER;
+  _final    = false;
+  _bits     = 0;
+  _bitCount = 0;
+  _count    = 0;
+  _position = 0;
+  _total    = 0;
+}
+
+bool OctoprintInflater::done() { return _state == OPAPI_INFLATE_DONE; }
+
+bool OctoprintInflater::failed() { return _state == OPAPI_INFLATE_ERROR; }
+
+int OctoprintInflater::fail() {
+  _state = OPAPI_INFLATE_ERROR;
+  return -1;
+}
+
+/**
+ * Make sure the bit buffer holds at least bits bits, false while the socket has not delivered them yet.
+ * */
+bool OctoprintInflater::need(OctoprintBodyStream &source, uint8_t bits) {
+  while (_bitCount < bits) {
+    int c = source.rawRead();
+    if (c < 0)
+      return false;
+    _bits |= (uint32_t)c << _bitCount;
+    _bitCount += 8;
+  }
+  return true;
+}
+
+uint16_t OctoprintInflater::take(uint8_t bits) {
+  uint16_t value = _bits & ((1UL << bits) - 1);
+  _bits >>= bits;
+  _bitCount -= bits;
+  return value;
+}
+
+/**
+ * Next symbol of a Huffman table, -1 while more input is needed (nothing consumed), -2 for an invalid code.
+ * */
+int OctoprintInflater::decode(OctoprintBodyStream &source, const uint16_t *counts, const uint16_t *symbols) {
+  need(source, 15);  // as much as there is, short codes may already be complete
+  int code  = 0;
+  int first = 0;
+  int index = 0;
+  for (uint8_t length = 1; length < 16; length++) {
+    if (length > _bitCount)
+      return -1;
+    code |= (_bits >> (length - 1)) & 1;
+    int count = counts[length];
+    if (code - count < first) {
+      take(length);
+      return symbols[index + code - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -2;
+}
+
+uint8_t OctoprintInflater::output(uint8_t c) {
+  _window[_position] = c;
+  _position          = (_position + 1) & (OPAPI_INFLATE_WINDOW - 1);
+  _total++;
+  return c;
+}
+
+/**
+ * Next optional gzip header field still to skip, in the order they appear.
+ * */
+uint8_t OctoprintInflater::gzipField() {
+  if (_flags & 0x04) {  // FEXTRA
+    _flags &= ~0x04;
+    return OPAPI_INFLATE_GZIP_EXTRA_LENGTH;
+  }
+  if (_flags & 0x18) {  // FNAME, then FCOMMENT
+    _flags &= (_flags & 0x08) ? ~0x08 : ~0x10;
+    return OPAPI_INFLATE_SKIP_STRING;
+  }
+  if (_flags & 0x02) {  // FHCRC
+    _flags &= ~0x02;
+    _count = 2;
+    return OPAPI_INFLATE_SKIP;
+  }
+  return OPAPI_INFLATE_BLOCK;
+}
+
+void OctoprintInflater::endBlock() { _state = _final ? OPAPI_INFLATE_DONE : OPAPI_INFLATE_BLOCK; }
+
+/** read()
+ * Next decompressed byte, -1 when the socket has nothing more for now, at the end of the stream or after an error.
+ * */
+int OctoprintInflater::read(OctoprintBodyStream &source) {
+  int symbol;
+  for (;;) {
+    switch (_state) {
+      case OPAPI_INFLATE_GZIP_HEADER: {  // ID1 ID2 CM FLG MTIME(4) XFL OS
+        if (!need(source, 8))
+          return -1;
+        uint8_t c = take(8);
+        if ((_count == 0 && c != 0x1f) || (_count == 1 && c != 0x8b) || (_count == 2 && c != 8) ||
+            (_count == 3 && (c & 0xe0)))
+          return fail();
+        if (_count == 3)
+          _flags = c;
+        if (++_count == 10)
+          _state = gzipField();
+        break;
+      }
+      case OPAPI_INFLATE_GZIP_EXTRA_LENGTH:
+        if (!need(source, 16))
+          return -1;
+        _count = take(16);
+        _state = OPAPI_INFLATE_SKIP;
+        break;
+      case OPAPI_INFLATE_SKIP:
+        while (_count > 0) {
+          if (!need(source, 8))
+            return -1;
+          take(8);
+          _count--;
+        }
+        _state = gzipField();
+        break;
+      case OPAPI_INFLATE_SKIP_STRING:
+        do {
+          if (!need(source, 8))
+            return -1;
+        } while (take(8) != 0);
+        _state = gzipField();
+        break;
+      case OPAPI_INFLATE_ZLIB_HEADER: {
+        if (!need(source, 16))
+          return -1;
+        uint8_t method = _bits & 0xff;
+        uint8_t flags  = (_bits >> 8) & 0xff;
+        // "deflate" should be zlib wrapped, but some servers send a bare deflate stream
+        if ((method & 0x0f) == 8 && ((method << 8) | flags) % 31 == 0) {
+          if (flags & 0x20)
+            return fail();  // preset dictionary
+          take(16);
+        }
+        _state = OPAPI_INFLATE_BLOCK;
+        break;
+      }
+      case OPAPI_INFLATE_BLOCK:
+        if (!need(source, 3))
+          return -1;
+        _final = take(1);
+        switch (take(2)) {
+          case 0:
+            take(_bitCount & 7);  // stored blocks start on a byte boundary
+            _state = OPAPI_INFLATE_STORED_LENGTH;
+            break;
+          case 1:
+            for (uint16_t i = 0; i < 288; i++)
+              _lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            inflateTable(_literalCounts, _literalSymbols, _lengths, 288);
+            memset(_lengths, 5, 30);
+            inflateTable(_distanceCounts, _distanceSymbols, _lengths, 30);
+            _state = OPAPI_INFLATE_CODES;
+            break;
+          case 2:
+            _state = OPAPI_INFLATE_TABLE_SIZES;
+            break;
+          default:
+            return fail();
+        }
+        break;
+      case OPAPI_INFLATE_STORED_LENGTH: {
+        if (!need(source, 32))
+          return -1;
+        uint16_t length = take(16);
+        if (length != (uint16_t)~take(16))
+          return fail();
+        _count = length;
+        _state = OPAPI_INFLATE_STORED;
+        break;
+      }
+      case OPAPI_INFLATE_STORED:
+        if (_count == 0) {
+          endBlock();
+          break;
+        }
+        if (!need(source, 8))
+          return -1;
+        _count--;
+        return output(take(8));
+      case OPAPI_INFLATE_TABLE_SIZES:
+        if (!need(source, 14))
+          return -1;
+        _literals    = take(5) + 257;
+        _distances   = take(5) + 1;
+        _codeLengths = take(4) + 4;
+        if (_literals > 286 || _distances > 30)
+          return fail();
+        _index = 0;
+        _state = OPAPI_INFLATE_CODE_LENGTHS;
+        break;
+      case OPAPI_INFLATE_CODE_LENGTHS:
+        for (; _index < 19; _index++) {
+          if (_index < _codeLengths && !need(source, 3))
+            return -1;
+          _lengths[pgm_read_byte(&inflateCodeLengthOrder[_index])] = _index < _codeLengths ? take(3) : 0;
+        }
+        // the code length code borrows the distance table until the real one is built
+        if (!inflateTable(_distanceCounts, _distanceSymbols, _lengths, 19))
+          return fail();
+        _index = 0;
+        _state = OPAPI_INFLATE_LENGTHS;
+        break;
+      case OPAPI_INFLATE_LENGTHS:
+        while (_index < _literals + _distances) {
+          symbol = decode(source, _distanceCounts, _distanceSymbols);
+          if (symbol == -1)
+            return -1;
+          if (symbol < 0)
+            return fail();
+          if (symbol >= 16) {
+            _symbol = symbol;
+            break;
+          }
+          _lengths[_index++] = symbol;
+        }
+        if (_index < _literals + _distances) {
+          _state = OPAPI_INFLATE_LENGTHS_REPEAT;
+          break;
+        }
+        if (_lengths[256] == 0 || !inflateTable(_literalCounts, _literalSymbols, _lengths, _literals) ||
+            !inflateTable(_distanceCounts, _distanceSymbols, _lengths + _literals, _distances))
+          return fail();
+        _state = OPAPI_INFLATE_CODES;
+        break;
+      case OPAPI_INFLATE_LENGTHS_REPEAT: {
+        uint8_t bits = _symbol == 16 ? 2 : _symbol == 17 ? 3 : 7;
+        if (!need(source, bits))
+          return -1;
+        uint16_t repeat = take(bits) + (_symbol == 18 ? 11 : 3);
+        if ((_symbol == 16 && _index == 0) || _index + repeat > _literals + _distances)
+          return fail();
+        uint8_t length = _symbol == 16 ? _lengths[_index - 1] : 0;
+        while (repeat-- > 0)
+          _lengths[_index++] = length;
+        _state = OPAPI_INFLATE_LENGTHS;
+        break;
+      }
+      case OPAPI_INFLATE_CODES:
+        symbol = decode(source, _literalCounts, _literalSymbols);
+        if (symbol == -1)
+          return -1;
+        if (symbol < 0 || symbol > 285)
+          return fail();
+        if (symbol < 256)
+          return output(symbol);
+        if (symbol == 256) {
+          endBlock();
+          break;
+        }
+        _symbol = symbol - 257;
+        _state  = OPAPI_INFLATE_LENGTH_EXTRA;
+        break;
+      case OPAPI_INFLATE_LENGTH_EXTRA: {
+        uint8_t bits = pgm_read_byte(&inflateLengthExtra[_symbol]);
+        if (!need(source, bits))
+          return -1;
+        _length = pgm_read_word(&inflateLengthBase[_symbol]) + take(bits);
+        _state  = OPAPI_INFLATE_DISTANCE;
+        break;
+      }
+      case OPAPI_INFLATE_DISTANCE:
+        symbol = decode(source, _distanceCounts, _distanceSymbols);
+        if (symbol == -1)
+          return -1;
+        if (symbol < 0 || symbol >= 30)
+          return fail();
+        _symbol = symbol;
+        _state  = OPAPI_INFLATE_DISTANCE_EXTRA;
+        break;
+      case OPAPI_INFLATE_DISTANCE_EXTRA: {
+        uint8_t bits = pgm_read_byte(&inflateDistanceExtra[_symbol]);
+        if (!need(source, bits))
+          return -1;
+        _distance = pgm_read_word(&inflateDistanceBase[_symbol]) + take(bits);
+        if (_distance > OPAPI_INFLATE_WINDOW || _distance > _total)
+          return fail();  // beyond the window we keep, or before the start of the stream
+        _state = OPAPI_INFLATE_COPY;
+        break;
+      }
+      case OPAPI_INFLATE_COPY:
+        if (_length == 0) {
+          _state = OPAPI_INFLATE_CODES;
+          break;
+        }
+        _length--;
+        return output(_window[(_position - _distance) & (OPAPI_INFLATE_WINDOW - 1)]);
+      default:
+        return -1;
+    }
+  }
+}
+#endif
+
+/***** REQUEST BUFFER *****/
+/**
+ * Collects a request so it leaves in a single write() instead of one per print(). On lwIP every write can become
+ * its own TCP segment and wait on Nagle for the previous one to be acknowledged. Anything larger than
+ * OPAPI_REQUEST_BUFFER_SIZE is sent in buffer sized pieces. writes counts the write() calls made on the client.
+ * */
+OctoprintRequestBuffer::OctoprintRequestBuffer(Client *client, unsigned long &writes)
+    : _client(client), _writes(writes), _length(0), _sent(0), _failed(false) {}
+
+size_t OctoprintRequestBuffer::write(uint8_t c) {
+  if (_length == OPAPI_REQUEST_BUFFER_SIZE)
+    send();
+  if (_failed)
+    return 0;
+  _buffer[_length++] = c;
+  return 1;
+}
+
+size_t OctoprintRequestBuffer::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    write(buffer[i]);
+  return size;
+}
+
+/** send()
+ * Writes out what is buffered, retrying partial writes like writeAll(). False once any of the request could not be
+ * sent, the rest of it is dropped then and the connection is no use any more.
+ * */
+bool OctoprintRequestBuffer::send() {
+  if (_length > 0 && !_failed) {
+    _failed = !clientWriteAll(_client, _buffer, _length, _writes);
+    if (!_failed)
+      _sent += _length;
+  }
+  _length = 0;
+  return !_failed;
+}
+
+size_t OctoprintRequestBuffer::sent() { return _sent; }
+
+/***** CHUNKED TRANSFER ENCODING *****/
+/**
+ * Byte at a time decoder for Transfer-Encoding: chunked. Framing bytes go to framing(), every body byte is
+ * acknowledged with data(), and finished() turns true on the terminating zero length chunk, so a request
+ * returns as soon as the last chunk arrives instead of waiting for OPAPI_TIMEOUT.
+ * */
+enum {
+  OPAPI_CHUNK_SIZE,
+  OPAPI_CHUNK_EXTENSION,
+  OPAPI_CHUNK_DATA,
+  OPAPI_CHUNK_DATA_END,
+  OPAPI_CHUNK_TRAILER_START,
+  OPAPI_CHUNK_TRAILER,
+  OPAPI_CHUNK_DONE
+};
+
+void OctoprintChunkDecoder::reset() {
+  _state     = OPAPI_CHUNK_SIZE;
+  _remaining = 0;
+}
+
+bool OctoprintChunkDecoder::wantsData() { return _state == OPAPI_CHUNK_DATA; }
+
+bool OctoprintChunkDecoder::finished() { return _state == OPAPI_CHUNK_DONE; }
+
+long OctoprintChunkDecoder::remaining() { return _remaining; }
+
+void OctoprintChunkDecoder::data() {
+  if (--_remaining == 0)
+    _state = OPAPI_CHUNK_DATA_END;
+}
+
+void OctoprintChunkDecoder::framing(char c) {
+  switch (_state) {
+    case OPAPI_CHUNK_SIZE:
+      if (c >= '0' && c <= '9')
+        _remaining = _remaining * 16 + (c - '0');
+      else if (c >= 'a' && c <= 'f')
+        _remaining = _remaining * 16 + (c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        _remaining = _remaining * 16 + (c - 'A' + 10);
+      else if (c == '\n')
+        _state = _remaining > 0 ? OPAPI_CHUNK_DATA : OPAPI_CHUNK_TRAILER_START;
+      else if (c != '\r')
+        _state = OPAPI_CHUNK_EXTENSION;
+      break;
+    case OPAPI_CHUNK_EXTENSION:
+      if (c == '\n')
+        _state = _remaining > 0 ? OPAPI_CHUNK_DATA : OPAPI_CHUNK_TRAILER_START;
+      break;
+    case OPAPI_CHUNK_DATA_END:  // CRLF after the chunk data
+      if (c == '\n')
+        _state = OPAPI_CHUNK_SIZE;
+      break;
+    case OPAPI_CHUNK_TRAILER_START:
+      if (c == '\n')
+        _state = OPAPI_CHUNK_DONE;
+      else if (c != '\r')
+        _state = OPAPI_CHUNK_TRAILER;
+      break;
+    case OPAPI_CHUNK_TRAILER:
+      if (c == '\n')
+        _state = OPAPI_CHUNK_TRAILER_START;
+      break;
+  }
+}
+
+/**
+ * Close the client
+ * */
+void OctoprintApi::closeClient() {
+  _connectionReusable = false;
+  _client->stop();
+}
+
+/** setKeepAlive()
+ * Keep the connection to OctoPrint open between requests instead of paying for a new (TLS) handshake every call.
+ * The server's Connection/Keep-Alive headers are honoured and a stale socket is reconnected once transparently.
+ * */
+void OctoprintApi::setKeepAlive(bool keepAlive) {
+  _keepAlive = keepAlive;
+  if (!keepAlive && _connectionReusable)
+    closeClient();
+}
+
+/** setClient()
+ * Switch to another client, e.g. one handed out from a pool. A kept-alive connection on the old client is closed first.
+ * */
+void OctoprintApi::setClient(Client &client) {
+  closeConnection();
+  _client = &client;
+}
+
+/** setResolver()
+ * Look the hostname up once and connect to the cached address, e.g. with octoprintHostByName or an mDNS query for
+ * octopi.local. NULL, the default, connects by name every time, which is what a TLS client checking the server's
+ * certificate against the hostname needs.
+ * */
+void OctoprintApi::setResolver(OctoprintResolver resolver) {
+  _resolver = resolver;
+  _resolved = false;
+}
+
+/** resolveHost()
+ * Look up the hostname now and keep the address for OPAPI_DNS_TTL ms, instead of a DNS or mDNS lookup on every
+ * connect. Call it once WiFi is up to get the lookup out of the way at boot. False if the lookup failed, or when
+ * there is no hostname or resolver.
+ * */
+bool OctoprintApi::resolveHost() {
+  _resolved = false;
+  if (_usingIpAddress || _resolver == NULL)
+    return false;
+  hostLookups++;
+  if (!_resolver(_octoPrintUrl, _resolvedIp)) {
+    if (_debug)
+      Serial.println("OctoprintApi::resolveHost() Lookup failed");
+    return false;
+  }
+  _resolved   = true;
+  _resolvedAt = millis();
+  return true;
+}
+
+/** closeConnection()
+ * Drop a kept-alive connection, e.g. before going to sleep.
+ * */
+void OctoprintApi::closeConnection() {
+  if (_connectionReusable)
+    closeClient();
+}
+
+/***** RESPONSE HEADER PARSER *****/
+/**
+ * Incremental HTTP response header parser, fed one byte at a time straight off the socket.
+ * Everything lives in fixed buffers so a request no longer leaves String fragments behind on the heap.
+ * Thanks Brian for the start of the original status code extraction, and the chuckle of watching you realise on a live stream that I didn't use the response code at that time! :)
+ * */
+enum {
+  OPAPI_PARSE_VERSION,
+  OPAPI_PARSE_STATUS,
+  OPAPI_PARSE_REASON,
+  OPAPI_PARSE_LINE_START,
+  OPAPI_PARSE_NAME,
+  OPAPI_PARSE_VALUE,
+  OPAPI_PARSE_DONE
+};
+
+enum {
+  OPAPI_HEADER_OTHER,
+  OPAPI_HEADER_CONTENT_LENGTH,
+  OPAPI_HEADER_TRANSFER_ENCODING,
+  OPAPI_HEADER_CONNECTION,
+  OPAPI_HEADER_CONTENT_TYPE,
+  OPAPI_HEADER_KEEP_ALIVE,
+  OPAPI_HEADER_ETAG,
+  OPAPI_HEADER_LAST_MODIFIED,
+  OPAPI_HEADER_CONTENT_ENCODING,
+  OPAPI_HEADER_WEBSOCKET_ACCEPT
+};
+
+void OctoprintResponseParser::reset() {
+  statusCode         = -1;
+  contentLength      = -1;
+  chunked            = false;
+  keepAlive          = true;
+  contentType        = OPAPI_CONTENT_UNKNOWN;
+  contentEncoding    = OPAPI_ENCODING_IDENTITY;
+  keepAliveTimeout   = -1;
+  keepAliveMax       = -1;
+  etag[0]            = '\0';
+  lastModified[0]    = '\0';
+  websocketAccept[0] = '\0';
+  _state             = OPAPI_PARSE_VERSION;
+  _header            = OPAPI_HEADER_OTHER;
+  _position          = 0;
+  _started           = false;
+}
+
+bool OctoprintResponseParser::started() { return _started; }
+
+bool OctoprintResponseParser::finished() { return _state == OPAPI_PARSE_DONE; }
+
+/**
+ * Feed the next byte of the response, returns true once the blank line closing the headers has been seen.
+ * */
+bool OctoprintResponseParser::parse(char c) {
+  _started = true;
+  char raw = c;
+  if (c >= 'A' && c <= 'Z')
+    c += 'a' - 'A';  // header names and the values we look at are case-insensitive, validators are kept as sent
+
+  switch (_state) {
+    case OPAPI_PARSE_VERSION:  // "http/1.1 "
+      if (c == ' ') {
+        keepAlive = !(_position == 8 && _buffer[0] == '0');  // HTTP/1.0 closes unless told otherwise
+        statusCode = 0;
+        _state     = OPAPI_PARSE_STATUS;
+      } else if (c == '\n')
+        _state = OPAPI_PARSE_LINE_START;
+      else {
+        _position++;
+        if (_position == 8)
+          _buffer[0] = c;  // minor version digit
+      }
+      break;
+    case OPAPI_PARSE_STATUS:
+      if (c >= '0' && c <= '9')
+        statusCode = statusCode * 10 + (c - '0');
+      else if (c == '\n')
+        _state = OPAPI_PARSE_LINE_START;
+      else
+        _state = OPAPI_PARSE_REASON;
+      break;
+    case OPAPI_PARSE_REASON:
+      if (c == '\n')
+        _state = OPAPI_PARSE_LINE_START;
+      break;
+    case OPAPI_PARSE_LINE_START:
+      if (c == '\n') {
+        _state = OPAPI_PARSE_DONE;
+        return true;
+      }
+      if (c == '\r')
+        break;
+      _position = 0;
+      _state    = OPAPI_PARSE_NAME;
+      // fall through
+    case OPAPI_PARSE_NAME:
+      if (c == ':') {
+        _buffer[_position] = '\0';
+        _header            = OPAPI_HEADER_OTHER;
+        if (strcmp(_buffer, "content-length") == 0)
+          _header = OPAPI_HEADER_CONTENT_LENGTH;
+        else if (strcmp(_buffer, "transfer-encoding") == 0)
+          _header = OPAPI_HEADER_TRANSFER_ENCODING;
+        else if (strcmp(_buffer, "connection") == 0)
+          _header = OPAPI_HEADER_CONNECTION;
+        else if (strcmp(_buffer, "content-type") == 0)
+          _header = OPAPI_HEADER_CONTENT_TYPE;
+        else if (strcmp(_buffer, "keep-alive") == 0)
+          _header = OPAPI_HEADER_KEEP_ALIVE;
+        else if (strcmp(_buffer, "etag") == 0)
+          _header = OPAPI_HEADER_ETAG;
+        else if (strcmp(_buffer, "last-modified") == 0)
+          _header = OPAPI_HEADER_LAST_MODIFIED;
+        else if (strcmp(_buffer, "content-encoding") == 0)
+          _header = OPAPI_HEADER_CONTENT_ENCODING;
+        else if (strcmp(_buffer, "sec-websocket-accept") == 0)
+          _header = OPAPI_HEADER_WEBSOCKET_ACCEPT;
+        _position = 0;
+        _state    = OPAPI_PARSE_VALUE;
+      } else if (c == '\n')
+        _state = OPAPI_PARSE_LINE_START;  // malformed line, ignore it
+      else if (_position < sizeof(_buffer) - 1)
+        _buffer[_position++] = c;
+      break;
+    case OPAPI_PARSE_VALUE: {
+      char *value = _buffer;
+      size_t size = sizeof(_buffer);
+      if (_header == OPAPI_HEADER_ETAG) {
+        value = etag;
+        size  = sizeof(etag);
+        c     = raw;
+      } else if (_header == OPAPI_HEADER_LAST_MODIFIED) {
+        value = lastModified;
+        size  = sizeof(lastModified);
+        c     = raw;
+      } else if (_header == OPAPI_HEADER_WEBSOCKET_ACCEPT) {
+        value = websocketAccept;
+        size  = sizeof(websocketAccept);
+        c     = raw;
+      }
+      if (c == '\n') {
+        value[_position] = '\0';
+        headerValue();
+        _state = OPAPI_PARSE_LINE_START;
+      } else if (_header == OPAPI_HEADER_OTHER || c == '\r' || (c == ' ' && _position == 0))
+        break;
+      else if (_position < size - 1)
+        value[_position++] = c;
+      break;
+    }
+  }
+  return false;
+}
+
+void OctoprintResponseParser::headerValue() {
+  const char *found;
+  switch (_header) {
+    case OPAPI_HEADER_CONTENT_LENGTH:
+      contentLength = atol(_buffer);
+      break;
+    case OPAPI_HEADER_TRANSFER_ENCODING:
+      chunked = strstr(_buffer, "chunked") != NULL;
+      break;
+    case OPAPI_HEADER_CONNECTION:
+      if (strstr(_buffer, "close"))
+        keepAlive = false;
+      else if (strstr(_buffer, "keep-alive"))
+        keepAlive = true;
+      break;
+    case OPAPI_HEADER_CONTENT_TYPE:
+      if (strncmp(_buffer, "application/json", 16) == 0)
+        contentType = OPAPI_CONTENT_JSON;
+      else if (strncmp(_buffer, "text/", 5) == 0)
+        contentType = OPAPI_CONTENT_TEXT;
+      else
+        contentType = OPAPI_CONTENT_OTHER;
+      break;
+    case OPAPI_HEADER_CONTENT_ENCODING:
+      if (strstr(_buffer, "gzip"))
+        contentEncoding = OPAPI_ENCODING_GZIP;
+      else if (strstr(_buffer, "deflate"))
+        contentEncoding = OPAPI_ENCODING_DEFLATE;
+      else if (_buffer[0] && strcmp(_buffer, "identity") != 0)
+        contentEncoding = OPAPI_ENCODING_OTHER;
+      break;
+    case OPAPI_HEADER_KEEP_ALIVE:
+      if ((found = strstr(_buffer, "timeout=")))
+        keepAliveTimeout = atol(found + 8);
+      if ((found = strstr(_buffer, "max=")))
+        keepAliveMax = atol(found + 4);
+      break;
+  }
 }
@@ -15,10 +15,35 @@
 #include <Client.h>
 
 #define OPAPI_TIMEOUT       3000
+#define OPAPI_KEEPALIVE_IDLE 5000  // ms an idle kept-alive connection is trusted when the server does not announce a timeout
 #define POSTDATA_SIZE       256
 #define POSTDATA_GCODE_SIZE 50
 #define JSONDOCUMENT_SIZE   1024
 #define USER_AGENT          "OctoPrintAPI/1.1.6 (Arduino)"
+#ifndef OPAPI_ASYNC_BUFFER_SIZE
+#define OPAPI_ASYNC_BUFFER_SIZE 1536  // response body buffer of the non-blocking requests
+#endif
+#define OPAPI_POLL_BUDGET   128       // bytes handled per poll() call
+#ifndef OPAPI_MAX_TOOLS
+#define OPAPI_MAX_TOOLS     4          // extruders kept in printerStats, tool0 to tool(OPAPI_MAX_TOOLS - 1)
+#endif
+#ifndef OPAPI_FILE_NAME_SIZE
+#define OPAPI_FILE_NAME_SIZE 64
+#endif
+#ifndef OPAPI_FILE_PATH_SIZE
+#define OPAPI_FILE_PATH_SIZE 128
+#endif
+#ifndef OPAPI_REQUEST_BUFFER_SIZE
+#define OPAPI_REQUEST_BUFFER_SIZE 512  // request line, headers and payload are gathered here and sent in one write
+#endif
+#ifdef OPAPI_GZIP
+#ifndef OPAPI_INFLATE_WINDOW
+#define OPAPI_INFLATE_WINDOW 4096  // power of two, how far back a compressed response may refer (nginx: gzip_window)
+#endif
+#endif
+#ifndef OPAPI_DNS_TTL
+#define OPAPI_DNS_TTL 300000  // ms a resolved hostname is reused before it is looked up again
+#endif
 
 struct printerStatistics {
   String printerState;
@@ -47,6 +72,16 @@ struct printerStatistics {
   float printerTool1TempActual;
   float printerTool1TempOffset;
   bool printerTool1Available;
+
+  uint8_t printerToolCount;  // one past the highest toolN reported, capped at OPAPI_MAX_TOOLS
+  float printerToolTempActual[OPAPI_MAX_TOOLS];
+  float printerToolTempTarget[OPAPI_MAX_TOOLS];
+  float printerToolTempOffset[OPAPI_MAX_TOOLS];
+
+  float printerChamberTempActual;
+  float printerChamberTempTarget;
+  float printerChamberTempOffset;
+  bool printerChamberAvailable;
 };
 
 struct octoprintVersion {
@@ -67,7 +102,7 @@ struct printJobCall {
   float progressCompletion;
   long progressFilepos;
   long progressPrintTime;
-  long progressPrintTimeLeft;
+  long progressPrintTimeLeft;  // -1 while OctoPrint has no estimate
   String progressprintTimeLeftOrigin;
 
   long jobFilamentTool0Length;
@@ -84,11 +119,337 @@ struct printerBedCall {
   float printerBedTempHistoryActual;
 };
 
+enum OctoprintState {
+  OPAPI_STATE_UNKNOWN,
+  OPAPI_STATE_OFFLINE,
+  OPAPI_STATE_CONNECTING,
+  OPAPI_STATE_OPERATIONAL,
+  OPAPI_STATE_PRINTING,
+  OPAPI_STATE_PAUSING,
+  OPAPI_STATE_PAUSED,
+  OPAPI_STATE_RESUMING,
+  OPAPI_STATE_CANCELLING,
+  OPAPI_STATE_FINISHING,
+  OPAPI_STATE_ERROR,
+  OPAPI_STATE_TRANSFERRING  // copying a file to the printer's SD card, the printer takes no jobs meanwhile
+};
+
+enum {
+  OPAPI_FLAG_OPERATIONAL     = 0x0001,
+  OPAPI_FLAG_PRINTING        = 0x0002,
+  OPAPI_FLAG_PAUSING         = 0x0004,
+  OPAPI_FLAG_PAUSED          = 0x0008,
+  OPAPI_FLAG_RESUMING        = 0x0010,
+  OPAPI_FLAG_CANCELLING      = 0x0020,
+  OPAPI_FLAG_FINISHING       = 0x0040,
+  OPAPI_FLAG_READY           = 0x0080,
+  OPAPI_FLAG_ERROR           = 0x0100,
+  OPAPI_FLAG_CLOSED_OR_ERROR = 0x0200,
+  OPAPI_FLAG_SD_READY        = 0x0400,
+  OPAPI_FLAG_BED             = 0x0800,  // bedActual/bedTarget are valid
+  OPAPI_FLAG_CHAMBER         = 0x1000   // chamberActual/chamberTarget are valid
+};
+
+enum OctoprintOrigin {
+  OPAPI_ORIGIN_UNKNOWN,
+  OPAPI_ORIGIN_LOCAL,
+  OPAPI_ORIGIN_SDCARD
+};
+
+enum OctoprintEstimate {
+  OPAPI_ESTIMATE_UNKNOWN,
+  OPAPI_ESTIMATE_LINEAR,
+  OPAPI_ESTIMATE_ANALYSIS,
+  OPAPI_ESTIMATE_AVERAGE,
+  OPAPI_ESTIMATE_MIXED_ANALYSIS,
+  OPAPI_ESTIMATE_MIXED_AVERAGE,
+  OPAPI_ESTIMATE_ESTIMATE,
+  OPAPI_ESTIMATE_GENIUS
+};
+
+/**
+ * Compact, String free versions of printerStatistics and printJobCall. Plain data, so they copy with = or memcpy.
+ * Temperatures are in tenths of a degree.
+ * */
+struct printerSnapshot {
+  uint8_t state;   // OctoprintState
+  uint16_t flags;  // OPAPI_FLAG_*
+  uint8_t toolCount;
+  int16_t bedActual;
+  int16_t bedTarget;
+  int16_t chamberActual;
+  int16_t chamberTarget;
+  int16_t toolActual[OPAPI_MAX_TOOLS];
+  int16_t toolTarget[OPAPI_MAX_TOOLS];
+};
+
+struct jobSnapshot {
+  uint8_t state;          // OctoprintState
+  uint8_t origin;         // OctoprintOrigin
+  uint8_t estimate;       // OctoprintEstimate, where printTimeLeft comes from
+  uint16_t completion;    // hundredths of a percent
+  uint32_t fileSize;
+  uint32_t fileDate;
+  uint32_t filepos;
+  uint32_t estimatedPrintTime;  // seconds
+  uint32_t printTime;
+  int32_t printTimeLeft;  // -1 while OctoPrint has no estimate
+  char fileName[OPAPI_FILE_NAME_SIZE];
+  char filePath[OPAPI_FILE_PATH_SIZE];
+};
+
+enum OctoprintContentType {
+  OPAPI_CONTENT_UNKNOWN,
+  OPAPI_CONTENT_JSON,
+  OPAPI_CONTENT_TEXT,
+  OPAPI_CONTENT_OTHER
+};
+
+enum OctoprintContentEncoding {
+  OPAPI_ENCODING_IDENTITY,
+  OPAPI_ENCODING_GZIP,
+  OPAPI_ENCODING_DEFLATE,
+  OPAPI_ENCODING_OTHER
+};
+
+class OctoprintResponseParser {
+ public:
+  void reset();
+  bool parse(char c);
+  bool started();
+  bool finished();
+  int statusCode;
+  long contentLength;
+  bool chunked;
+  bool keepAlive;
+  OctoprintContentType contentType;
+  OctoprintContentEncoding contentEncoding;
+  long keepAliveTimeout;
+  long keepAliveMax;
+  char etag[48];
+  char lastModified[32];
+  char websocketAccept[32];
+
+ private:
+  void headerValue();
+  uint8_t _state;
+  uint8_t _header;
+  uint8_t _position;
+  bool _started;
+  char _buffer[40];
+};
+
+class OctoprintChunkDecoder {
+ public:
+  void reset();
+  void framing(char c);
+  void data();
+  bool wantsData();
+  bool finished();
+  long remaining();
+
+ private:
+  uint8_t _state;
+  long _remaining;
+};
+
+#ifdef OPAPI_GZIP
+class OctoprintBodyStream;
+
+class OctoprintInflater {
+ public:
+  void begin(OctoprintContentEncoding encoding);
+  int read(OctoprintBodyStream &source);
+  bool done();
+  bool failed();
+
+ private:
+  uint8_t _state;
+  bool _final;
+  uint8_t _flags;
+  uint32_t _bits;
+  uint8_t _bitCount;
+  uint16_t _count;
+  uint16_t _index;
+  uint16_t _symbol;
+  uint16_t _length;
+  uint16_t _distance;
+  uint16_t _literals;
+  uint16_t _distances;
+  uint16_t _codeLengths;
+  uint16_t _position;
+  uint32_t _total;
+  uint8_t _lengths[320];
+  uint16_t _literalCounts[16];
+  uint16_t _literalSymbols[288];
+  uint16_t _distanceCounts[16];
+  uint16_t _distanceSymbols[32];
+  uint8_t _window[OPAPI_INFLATE_WINDOW];
+  bool need(OctoprintBodyStream &source, uint8_t bits);
+  uint16_t take(uint8_t bits);
+  int decode(OctoprintBodyStream &source, const uint16_t *counts, const uint16_t *symbols);
+  uint8_t output(uint8_t c);
+  uint8_t gzipField();
+  void endBlock();
+  int fail();
+};
+#endif
+
+class OctoprintBodyStream : public Stream {
+ public:
+  void begin(Client *client, long length, bool chunked, OctoprintContentEncoding encoding = OPAPI_ENCODING_IDENTITY);
+  long length();
+  long received();
+  uint32_t hash();
+  bool framed();
+  bool finished();
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t);
+  void flush();
+  bool debug = false;
+#ifdef OPAPI_GZIP
+  OctoprintBodyStream() {}
+  ~OctoprintBodyStream();
+#endif
+
+ private:
+  Client *_client = NULL;
+  long _length    = 0;
+  long _remaining = 0;  // -1 means read until the server closes the connection
+  bool _chunked   = false;
+  uint32_t _hash  = 0;
+  long _received  = 0;
+  OctoprintChunkDecoder _chunks;
+  void skipFraming();
+  int rawRead();
+  bool rawFinished();
+#ifdef OPAPI_GZIP
+  friend class OctoprintInflater;
+  bool _compressed = false;
+  int _next        = -1;
+  OctoprintInflater *_inflate = NULL;  // allocated with the first compressed response, kept for the next
+  int inflate();
+  OctoprintBodyStream(const OctoprintBodyStream &);
+  OctoprintBodyStream &operator=(const OctoprintBodyStream &);
+#endif
+};
+
+class OctoprintHashPrint : public Print {
+ public:
+  size_t write(uint8_t c);
+  uint32_t hash();
+
+ private:
+  uint32_t _hash = 2166136261UL;
+};
+
+class OctoprintRequestBuffer : public Print {
+ public:
+  OctoprintRequestBuffer(Client *client, unsigned long &writes);
+  using Print::write;
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  bool send();
+  size_t sent();
+
+ private:
+  Client *_client;
+  unsigned long &_writes;
+  size_t _length;
+  size_t _sent;
+  bool _failed;
+  uint8_t _buffer[OPAPI_REQUEST_BUFFER_SIZE];
+};
+
+#ifndef OPAPI_COMMAND_BATCH_SIZE
+#define OPAPI_COMMAND_BATCH_SIZE 256  // payload buffer of OctoprintCommandBatch
+#endif
+#ifndef OPAPI_JOG_INTERVAL
+#define OPAPI_JOG_INTERVAL 100  // ms between two merged jogs of OctoprintJogger
+#endif
+#ifndef OPAPI_UPLOAD_CHUNK_SIZE
+#define OPAPI_UPLOAD_CHUNK_SIZE 1460  // one full TCP segment on lwIP
+#endif
+#define OPAPI_UPLOAD_BOUNDARY "----OctoPrintAPIUpload7d4a1f2c9e"
+
+struct octoprintFile {
+  char name[OPAPI_FILE_NAME_SIZE];
+  char path[OPAPI_FILE_PATH_SIZE];
+  bool folder;
+  long size;
+  long date;
+  float estimatedPrintTime;  // seconds, 0 until OctoPrint has analysed the file
+};
+
+#ifdef OPAPI_METRICS
+#define OPAPI_METRICS_ENDPOINTS 7  // job, printer, files, connection, system, version, everything else
+#define OPAPI_METRICS_BUCKETS   9  // up to 10, 25, 50, 100, 250, 500, 1000, 2500 ms and slower
+
+struct octoprintEndpointMetrics {
+  uint32_t requests;
+  uint32_t connectFailures;
+  uint32_t timeouts;      // connected, but no complete response headers
+  uint32_t clientErrors;  // 4xx
+  uint32_t serverErrors;  // 5xx
+  int lastError;          // last status other than 2xx and 304, -1 when there was no response
+  uint32_t bytesOut;
+  uint32_t bytesIn;
+  uint16_t connectTime[OPAPI_METRICS_BUCKETS];
+  uint16_t firstByteTime[OPAPI_METRICS_BUCKETS];  // connected until the first byte of the response
+  uint16_t parseTime[OPAPI_METRICS_BUCKETS];  // end of the headers until the body has been read and parsed
+  uint16_t totalTime[OPAPI_METRICS_BUCKETS];
+};
+
+struct octoprintMetrics {
+  octoprintEndpointMetrics endpoints[OPAPI_METRICS_ENDPOINTS];
+};
+#endif
+
+struct responseCache {
+  bool valid = false;
+  char etag[48];
+  char lastModified[32];
+  uint32_t bodyHash;
+};
+
+enum OctoprintUpdate {
+  OPAPI_UPDATE_FAILED,
+  OPAPI_UPDATE_UNCHANGED,
+  OPAPI_UPDATE_CHANGED
+};
+
+class OctoprintApi;
+typedef void (*OctoprintCallback)(OctoprintApi *api, bool success);
+typedef bool (*OctoprintFileCallback)(OctoprintApi *api, const octoprintFile &file);
+typedef void (*OctoprintUploadCallback)(OctoprintApi *api, unsigned long sent, unsigned long total);
+typedef bool (*OctoprintResolver)(const char *host, IPAddress &ip);
+#if defined(ESP8266) || defined(ESP32)
+bool octoprintHostByName(const char *host, IPAddress &ip);
+#endif
+
+enum {
+  OPAPI_ASYNC_IDLE,
+  OPAPI_ASYNC_HEADERS,
+  OPAPI_ASYNC_BODY
+};
+
+enum {
+  OPAPI_ASYNC_RAW,
+  OPAPI_ASYNC_PRINT_JOB,
+  OPAPI_ASYNC_PRINTER_STATISTICS
+};
+
 class OctoprintApi {
+  friend class OctoprintPushClient;
+  friend class OctoprintTemperatureHistory;
+
  public:
   OctoprintApi(void);
   OctoprintApi(Client &client, IPAddress octoPrintIp, int octoPrintPort, String apiKey);
   OctoprintApi(Client &client, char *octoPrintUrl, int octoPrintPort, String apiKey);
+  ~OctoprintApi();
   void init(Client &client, char *octoPrintUrl, int octoPrintPort, String apiKey);
   void init(Client &client, IPAddress octoPrintIp, int octoPrintPort, String apiKey);
   String sendGetToOctoprint(String command);
@@ -98,10 +459,13 @@ class OctoprintApi {
   printerStatistics printerStats;
   octoprintVersion octoprintVer;
   bool getPrintJob();
+  OctoprintUpdate updatePrintJob();
+  OctoprintUpdate updatePrinterStatistics();
   printJobCall printJob;
   bool _debug          = false;
   int httpStatusCode   = 0;
   String httpErrorBody = "";
+  unsigned long requestWrites = 0;
   String sendPostToOctoPrint(String command, const char *postData);
   bool octoPrintConnectionDisconnect();
   bool octoPrintConnectionAutoConnect();
@@ -114,6 +478,8 @@ class OctoprintApi {
   bool octoPrintSetBedTemperature(uint16_t t);
   bool octoPrintSetTool0Temperature(uint16_t t);
   bool octoPrintSetTool1Temperature(uint16_t t);
+  bool octoPrintSetToolTemperature(uint8_t tool, uint16_t t);
+  bool octoPrintSetToolTemperatures(const uint16_t *targets, uint8_t count);
 
   bool octoPrintGetPrinterSD();
   bool octoPrintPrinterSDInit();
@@ -123,6 +489,11 @@ class OctoprintApi {
   bool octoPrintGetPrinterBed();
   printerBedCall printerBed;
 
+  bool refreshAll();
+
+  bool getPrinterSnapshot(printerSnapshot &snapshot);
+  bool getJobSnapshot(jobSnapshot &snapshot);
+
   bool octoPrintJobStart();
   bool octoPrintJobCancel();
   bool octoPrintJobRestart();
@@ -130,6 +501,14 @@ class OctoprintApi {
   bool octoPrintJobPause();
   bool octoPrintJobResume();
   bool octoPrintFileSelect(String &path);
+  bool octoPrintListFiles(OctoprintFileCallback callback, const char *folder = NULL, int offset = 0, int limit = 0);
+  bool octoPrintUploadFile(const char *path, Stream &source, unsigned long size, OctoprintUploadCallback progress = NULL);
+  float uploadThroughput = 0;  // bytes per second of the last upload
+#ifdef OPAPI_METRICS
+  octoprintMetrics metrics = {};
+  void resetMetrics();
+  void printMetrics(Print &out);
+#endif
 
   bool octoPrintCoreShutdown();
   bool octoPrintCoreReboot();
@@ -137,6 +516,21 @@ class OctoprintApi {
 
   bool octoPrintPrinterCommand(char *gcodeCommand);
 
+  void setKeepAlive(bool keepAlive);
+  void closeConnection();
+  void setClient(Client &client);
+  void setResolver(OctoprintResolver resolver);
+  bool resolveHost();
+  unsigned long hostLookups = 0;  // lookups made through the resolver
+
+  bool beginGetPrintJob(OctoprintCallback callback = NULL);
+  bool beginGetPrinterStatistics(OctoprintCallback callback = NULL);
+  bool beginSendPostToOctoPrint(String command, const char *postData, OctoprintCallback callback = NULL);
+  bool poll();
+  bool requestInProgress();
+  bool requestSucceeded();
+  bool requestChanged();
+
  private:
   Client *_client;
   String _apiKey;
@@ -144,10 +538,124 @@ class OctoprintApi {
   bool _usingIpAddress;
   char *_octoPrintUrl;
   int _octoPrintPort;
+  OctoprintResolver _resolver     = NULL;
+  IPAddress _resolvedIp;
+  bool _resolved                  = false;
+  unsigned long _resolvedAt       = 0;
   const int maxMessageLength = 1000;
+  bool _keepAlive                 = false;
+  bool _connectionReusable        = false;
+  unsigned long _lastResponseTime = 0;
+  unsigned long _keepAliveIdle    = OPAPI_KEEPALIVE_IDLE;
+  long _keepAliveRemaining        = -1;
+  OctoprintResponseParser _response;
+  OctoprintBodyStream _body;
+  bool connectToOctoprint(bool &reused);
+  uint8_t _asyncState = OPAPI_ASYNC_IDLE;
+  uint8_t _asyncKind;
+  bool _asyncPost;
+  bool _asyncHasData;
+  bool _asyncReused;
+  bool _asyncOverflow;
+  bool _asyncSuccess = false;
+  bool _asyncChanged = false;
+  responseCache _printJobCache;
+  responseCache _printerStatisticsCache;
+  String _asyncCommand;
+  OctoprintCallback _asyncCallback;
+  unsigned long _asyncStart;
+  int _asyncLength;
+  char *_asyncBuffer = NULL;  // OPAPI_ASYNC_BUFFER_SIZE bytes, allocated on first use by begin...() or readCachedBody()
+  bool beginRequest(bool post, const char *command, const char *data, const responseCache *cache = NULL);
+  bool sendRequest(bool post, const char *command, const char *data, bool &reused, const responseCache *cache = NULL);
+  void writeRequestHead(Print &request, bool post, const char *command, const responseCache *cache);
+  bool writeAll(const uint8_t *buffer, size_t size);
+  bool uploadFailed(const char *reason);
+  bool readResponseHeaders(int budget);
+  bool startBody();
+  void endRequest();
+  bool beginGetToOctoprint(const char *command, const responseCache *cache = NULL);
+  void readErrorBody();
+  void readErrorText(char *text, size_t size);
+  bool nextElement();
+  bool sendCommand(uint8_t id);
+  bool updateCache(responseCache &cache, uint32_t bodyHash);
+  bool allocateBodyBuffer();
+  OctoprintUpdate readCachedBody(JsonDocument &root, JsonDocument &filter, responseCache &cache);
+  responseCache *asyncCache();
+  bool beginAsyncRequest(bool post, String command, const char *data, uint8_t kind, OctoprintCallback callback);
+  void finishAsync(bool success);
+  void printerStatisticsFilter(JsonDocument &filter);
+  void parsePrinterStatistics(JsonDocument &root);
+  void parsePrinterState(JsonObject state);
+  void parseTemperatures(JsonObject temperature);
+  void parsePrinterBed(JsonObject temperature);
+  bool printerStatisticsFailed();
+  void printJobFilter(JsonDocument &filter);
+  void parsePrintJob(JsonObject root);
   void closeClient();
-  int extractHttpCode(String statusCode, String body);
+#ifdef OPAPI_METRICS
+  bool _metricsActive = false;
+  uint8_t _metricsEndpoint;
+  unsigned long _metricsStart;
+  long _metricsConnect;
+  long _metricsFirstByte;
+  long _metricsHeaders;
+  void metricsBegin(const char *command);
+  void metricsConnected();
+  void metricsFirstByte();
+  void metricsHeaders();
+  void metricsSent(size_t bytes);
+  void metricsReceived(size_t bytes);
+  void metricsEnd();
+#else
+  // Compiled out, these cost nothing.
+  void metricsBegin(const char *) {}
+  void metricsConnected() {}
+  void metricsFirstByte() {}
+  void metricsHeaders() {}
+  void metricsSent(size_t) {}
+  void metricsReceived(size_t) {}
+  void metricsEnd() {}
+#endif
   String sendRequestToOctoprint(String type, String command, const char *data);
+  OctoprintApi(const OctoprintApi &);  // owns its buffers, not copyable
+  OctoprintApi &operator=(const OctoprintApi &);
+};
+
+class OctoprintCommandBatch {
+ public:
+  OctoprintCommandBatch(OctoprintApi &api);
+  bool add(const char *command);
+  bool flush();
+  void clear();
+  uint8_t count();
+
+ private:
+  OctoprintApi &_api;
+  size_t _length;
+  uint8_t _count;
+  char _buffer[OPAPI_COMMAND_BATCH_SIZE];
+};
+
+class OctoprintJogger {
+ public:
+  OctoprintJogger(OctoprintApi &api);
+  void move(float x, float y, float z);
+  void setInterval(unsigned long interval);
+  void setSpeed(float speed);
+  bool pending();
+  void cancel();
+  bool poll();
+
+ private:
+  OctoprintApi &_api;
+  float _x;
+  float _y;
+  float _z;
+  float _speed;
+  unsigned long _interval;
+  unsigned long _lastJog;
 };
 
 #endif
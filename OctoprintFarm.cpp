@@ -0,0 +1,185 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintFarm.h"
+
+/** OctoprintFarm
+ * Keeps a bank of OctoPrint servers up to date over a small pool of clients. A refresh fetches /api/printer and
+ * /api/job for every printer, running as many printers side by side as there are clients, so a full refresh takes
+ * about as long as the slowest printer instead of the sum of all of them.
+ * Printers hold on to the client they used last, so with keep-alive the next refresh skips the connect.
+ * */
+enum {
+  OPFARM_IDLE,
+  OPFARM_PENDING,
+  OPFARM_STATISTICS,
+  OPFARM_JOB
+};
+
+OctoprintFarm::OctoprintFarm(void) {
+  _printerCount = 0;
+  _clientCount  = 0;
+}
+
+/** addClient()
+ * Add a client to the pool, each one lets another printer be refreshed at the same time.
+ * Add at least one before the printers.
+ * */
+bool OctoprintFarm::addClient(Client &client) {
+  if (_clientCount >= OPFARM_MAX_CLIENTS)
+    return false;
+  _clients[_clientCount]     = &client;
+  _clientOwner[_clientCount] = -1;
+  _clientBusy[_clientCount]  = false;
+  _clientCount++;
+  return true;
+}
+
+/** addPrinter()
+ * Returns the index of the printer in printers[], or -1 if the farm is full or there is no client yet.
+ * */
+int OctoprintFarm::addPrinter(IPAddress octoPrintIp, int octoPrintPort, String apiKey) {
+  if (_printerCount >= OPFARM_MAX_PRINTERS || _clientCount == 0)
+    return -1;
+  _apis[_printerCount].init(*_clients[0], octoPrintIp, octoPrintPort, apiKey);
+  _apis[_printerCount].setKeepAlive(true);
+  _step[_printerCount]           = OPFARM_IDLE;
+  _printerClient[_printerCount]  = -1;
+  printers[_printerCount].online = false;
+  return _printerCount++;
+}
+
+int OctoprintFarm::addPrinter(char *octoPrintUrl, int octoPrintPort, String apiKey) {
+  if (_printerCount >= OPFARM_MAX_PRINTERS || _clientCount == 0)
+    return -1;
+  _apis[_printerCount].init(*_clients[0], octoPrintUrl, octoPrintPort, apiKey);
+  _apis[_printerCount].setKeepAlive(true);
+  _step[_printerCount]           = OPFARM_IDLE;
+  _printerClient[_printerCount]  = -1;
+  printers[_printerCount].online = false;
+  return _printerCount++;
+}
+
+uint8_t OctoprintFarm::printerCount() { return _printerCount; }
+
+/** api()
+ * The OctoprintApi behind a printer, to send it commands. Do not use it while a refresh is running.
+ * */
+OctoprintApi &OctoprintFarm::api(uint8_t printer) { return _apis[printer]; }
+
+/** refresh()
+ * Queue every printer for an update, poll() then does the work. Printers still busy from the last refresh are left alone.
+ * */
+void OctoprintFarm::refresh() {
+  for (uint8_t i = 0; i < _printerCount; i++) {
+    if (_step[i] == OPFARM_IDLE)
+      _step[i] = OPFARM_PENDING;
+  }
+}
+
+/** poll()
+ * Call from loop(), never blocks on a response. Returns true while a refresh is still running.
+ * */
+bool OctoprintFarm::poll() {
+  bool busy = false;
+
+  for (uint8_t i = 0; i < _printerCount; i++) {
+    if (_step[i] != OPFARM_STATISTICS && _step[i] != OPFARM_JOB)
+      continue;
+    busy = true;
+    if (_apis[i].poll())
+      continue;
+
+    if (!_apis[i].requestSucceeded())
+      finishPrinter(i, false);
+    else if (_step[i] == OPFARM_STATISTICS) {
+      // same client, and with keep-alive the same connection
+      _step[i] = OPFARM_JOB;
+      if (!_apis[i].beginGetPrintJob())
+        finishPrinter(i, false);
+    } else
+      finishPrinter(i, true);
+  }
+
+  for (uint8_t i = 0; i < _printerCount; i++) {
+    if (_step[i] != OPFARM_PENDING)
+      continue;
+    busy = true;
+    if (acquireClient(i) < 0)
+      break;
+    startPrinter(i);
+  }
+  return busy;
+}
+
+/** update()
+ * Blocking refresh of the whole farm, returns the number of printers that answered.
+ * */
+uint8_t OctoprintFarm::update() {
+  refresh();
+  while (poll())
+    yield();
+
+  uint8_t online = 0;
+  for (uint8_t i = 0; i < _printerCount; i++) {
+    if (printers[i].online)
+      online++;
+  }
+  return online;
+}
+
+/**
+ * Hand a free client to the printer, preferring the one it used last so a kept-alive connection can be reused.
+ * */
+int OctoprintFarm::acquireClient(uint8_t printer) {
+  int chosen = -1;
+  for (uint8_t c = 0; c < _clientCount; c++) {
+    if (_clientBusy[c])
+      continue;
+    if (_clientOwner[c] == printer) {
+      chosen = c;
+      break;
+    }
+    if (chosen < 0 || _clientOwner[c] == -1)
+      chosen = c;
+  }
+  if (chosen < 0)
+    return -1;
+
+  if (_clientOwner[chosen] != printer) {
+    int8_t previous = _clientOwner[chosen];
+    if (previous >= 0 && _printerClient[previous] == chosen) {
+      _apis[previous].closeConnection();  // its idle connection lives on the client we are taking
+      _printerClient[previous] = -1;
+    }
+    _apis[printer].setClient(*_clients[chosen]);
+    _clientOwner[chosen] = printer;
+  }
+  _clientBusy[chosen]     = true;
+  _printerClient[printer] = chosen;
+  return chosen;
+}
+
+void OctoprintFarm::startPrinter(uint8_t printer) {
+  _step[printer] = OPFARM_STATISTICS;
+  if (!_apis[printer].beginGetPrinterStatistics())
+    finishPrinter(printer, false);
+}
+
+void OctoprintFarm::finishPrinter(uint8_t printer, bool success) {
+  _step[printer]           = OPFARM_IDLE;
+  printers[printer].online = success;
+  if (success) {
+    printers[printer].printerStats = _apis[printer].printerStats;
+    printers[printer].printJob     = _apis[printer].printJob;
+    printers[printer].lastUpdate   = millis();
+  }
+  if (_printerClient[printer] >= 0)
+    _clientBusy[_printerClient[printer]] = false;
+}
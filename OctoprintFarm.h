@@ -0,0 +1,56 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintFarm_h
+#define OctoprintFarm_h
+
+#include "OctoPrintAPI.h"
+
+#ifndef OPFARM_MAX_PRINTERS
+#define OPFARM_MAX_PRINTERS 8
+#endif
+#ifndef OPFARM_MAX_CLIENTS
+#define OPFARM_MAX_CLIENTS 4
+#endif
+
+struct farmPrinter {
+  bool online;
+  unsigned long lastUpdate;
+  printerStatistics printerStats;
+  printJobCall printJob;
+};
+
+class OctoprintFarm {
+ public:
+  OctoprintFarm(void);
+  bool addClient(Client &client);
+  int addPrinter(IPAddress octoPrintIp, int octoPrintPort, String apiKey);
+  int addPrinter(char *octoPrintUrl, int octoPrintPort, String apiKey);
+  uint8_t printerCount();
+  OctoprintApi &api(uint8_t printer);
+  void refresh();
+  bool poll();
+  uint8_t update();
+  farmPrinter printers[OPFARM_MAX_PRINTERS];
+
+ private:
+  OctoprintApi _apis[OPFARM_MAX_PRINTERS];
+  uint8_t _step[OPFARM_MAX_PRINTERS];
+  int8_t _printerClient[OPFARM_MAX_PRINTERS];
+  uint8_t _printerCount;
+  Client *_clients[OPFARM_MAX_CLIENTS];
+  int8_t _clientOwner[OPFARM_MAX_CLIENTS];
+  bool _clientBusy[OPFARM_MAX_CLIENTS];
+  uint8_t _clientCount;
+  int acquireClient(uint8_t printer);
+  void startPrinter(uint8_t printer);
+  void finishPrinter(uint8_t printer, bool success);
+};
+
+#endif
@@ -0,0 +1,145 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintProgress.h"
+
+/** OctoprintProgress
+ * Dead reckoning between polls of /api/job. Every update() anchors the estimate to what OctoPrint reported, in between
+ * completion(), printTime() and printTimeLeft() carry on from millis() at the rate the file is being read, so a
+ * progress bar keeps moving smoothly while the job is only fetched every 30 seconds or so.
+ * drift() and etaDrift() say how far off the estimate was when the last poll came in.
+ * */
+OctoprintProgress::OctoprintProgress(void) { clear(); }
+
+void OctoprintProgress::clear() {
+  _anchored      = false;
+  _printing      = false;
+  _anchorTime    = 0;
+  _fileSize      = 0;
+  _fileDate      = 0;
+  _filepos       = 0;
+  _printTime     = 0;
+  _printTimeLeft = -1;
+  _rate          = 0;
+  _floor         = 0;
+  _drift         = 0;
+  _etaDrift      = 0;
+}
+
+/** update()
+ * Feed it every printJob (or jobSnapshot) fetched, right after fetching it.
+ * */
+void OctoprintProgress::update(const printJobCall &job) {
+  anchor(job.printerState.startsWith("Printing"), job.jobFileSize, job.jobFileDate, job.progressFilepos,
+         job.progressPrintTime, job.progressPrintTimeLeft);
+}
+
+void OctoprintProgress::update(const jobSnapshot &job) {
+  anchor(job.state == OPAPI_STATE_PRINTING, job.fileSize, job.fileDate, job.filepos, job.printTime,
+         job.printTimeLeft);
+}
+
+void OctoprintProgress::anchor(bool printing, long fileSize, long fileDate, long filepos, long printTime,
+                               long printTimeLeft) {
+  unsigned long now = millis();
+  bool sameJob      = _anchored && fileSize == _fileSize && fileDate == _fileDate && filepos >= _filepos;
+
+  if (sameJob && _printing) {
+    float predicted    = completion();
+    long predictedLeft = this->printTimeLeft();
+    _drift             = fileSize > 0 ? 100.0 * filepos / fileSize - predicted : 0;
+    _etaDrift          = (predictedLeft >= 0 && printTimeLeft >= 0) ? printTimeLeft - predictedLeft : 0;
+    _floor             = predicted;  // rather hold the bar for a moment than make it jump back
+
+    unsigned long interval = now - _anchorTime;
+    if (interval > 0 && filepos > _filepos) {
+      float rate = (filepos - _filepos) * 1000.0 / interval;
+      _rate      = _rate > 0 ? (_rate + rate) / 2 : rate;
+    }
+  } else {
+    _drift    = 0;
+    _etaDrift = 0;
+    _floor    = 0;
+    _rate     = printTime > 0 ? (float)filepos / printTime : 0;  // the average so far until there are two polls
+  }
+
+  _anchored      = true;
+  _printing      = printing;
+  _anchorTime    = now;
+  _fileSize      = fileSize;
+  _fileDate      = fileDate;
+  _filepos       = filepos;
+  _printTime     = printTime;
+  _printTimeLeft = printTimeLeft;
+}
+
+/** elapsed()
+ * Milliseconds to extrapolate over, nothing moves while the printer is not printing.
+ * */
+unsigned long OctoprintProgress::elapsed() { return _printing ? millis() - _anchorTime : 0; }
+
+bool OctoprintProgress::printing() { return _printing; }
+
+/** filepos()
+ * Estimated position in the file being printed, in bytes.
+ * */
+long OctoprintProgress::filepos() {
+  long filepos = _filepos + (long)(_rate * elapsed() / 1000);
+  if (_fileSize > 0 && filepos > _fileSize)
+    filepos = _fileSize;
+  return filepos;
+}
+
+/** completion()
+ * Estimated completion in percent, 0 without a job.
+ * */
+float OctoprintProgress::completion() {
+  if (_fileSize <= 0)
+    return 0;
+  float completion = 100.0 * filepos() / _fileSize;
+  return completion > _floor ? completion : _floor;
+}
+
+/** printTime()
+ * Estimated seconds printed so far.
+ * */
+long OctoprintProgress::printTime() { return _printTime + elapsed() / 1000; }
+
+/** printTimeLeft()
+ * Estimated seconds to go. Counts down OctoPrint's own estimate, or works it out from the reading rate while
+ * OctoPrint has none. -1 if neither is known.
+ * */
+long OctoprintProgress::printTimeLeft() {
+  if (_printTimeLeft >= 0) {
+    long left = _printTimeLeft - (long)(elapsed() / 1000);
+    return left > 0 ? left : 0;
+  }
+  if (_rate <= 0 || _fileSize <= 0)
+    return -1;
+  return (long)((_fileSize - filepos()) / _rate);
+}
+
+/** drift()
+ * Percent OctoPrint reported at the last poll minus what completion() estimated, positive if the print ran ahead.
+ * */
+float OctoprintProgress::drift() { return _drift; }
+
+/** etaDrift()
+ * Seconds OctoPrint reported left at the last poll minus what printTimeLeft() estimated.
+ * */
+long OctoprintProgress::etaDrift() { return _etaDrift; }
+
+/** drifting()
+ * True when the last poll was further off than OPAPI_PROGRESS_DRIFT or OPAPI_ETA_DRIFT, e.g. a long layer of infill
+ * after a run of travel moves. Worth polling sooner when it is.
+ * */
+bool OctoprintProgress::drifting() {
+  return _drift > OPAPI_PROGRESS_DRIFT || _drift < -OPAPI_PROGRESS_DRIFT || _etaDrift > OPAPI_ETA_DRIFT ||
+         _etaDrift < -OPAPI_ETA_DRIFT;
+}
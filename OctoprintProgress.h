@@ -0,0 +1,54 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintProgress_h
+#define OctoprintProgress_h
+
+#include "OctoPrintAPI.h"
+
+#ifndef OPAPI_PROGRESS_DRIFT
+#define OPAPI_PROGRESS_DRIFT 2.0  // percent the estimate may be off at a poll before drifting() says so
+#endif
+#ifndef OPAPI_ETA_DRIFT
+#define OPAPI_ETA_DRIFT 120  // seconds the time left may be off at a poll before drifting() says so
+#endif
+
+class OctoprintProgress {
+ public:
+  OctoprintProgress(void);
+  void update(const printJobCall &job);
+  void update(const jobSnapshot &job);
+  void clear();
+  bool printing();
+  float completion();
+  long filepos();
+  long printTime();
+  long printTimeLeft();
+  float drift();
+  long etaDrift();
+  bool drifting();
+
+ private:
+  bool _anchored;
+  bool _printing;
+  unsigned long _anchorTime;
+  long _fileSize;
+  long _fileDate;
+  long _filepos;
+  long _printTime;
+  long _printTimeLeft;
+  float _rate;   // bytes per second
+  float _floor;  // completion() does not go back below this after a poll
+  float _drift;
+  long _etaDrift;
+  void anchor(bool printing, long fileSize, long fileDate, long filepos, long printTime, long printTimeLeft);
+  unsigned long elapsed();
+};
+
+#endif
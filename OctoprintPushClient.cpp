@@ -0,0 +1,538 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintPushClient.h"
+
+/** OctoprintPushClient()
+ * http://docs.octoprint.org/en/master/api/push.html
+ * Instead of polling /api/job and /api/printer, keep one WebSocket open to /sockjs/websocket and let OctoPrint
+ * push its "current" messages (state, job, progress, temperatures) about twice a second.
+ * The messages fill the same printerStatistics and printJobCall structs as OctoprintApi.
+ * */
+OctoprintPushClient::OctoprintPushClient(Client &client, IPAddress octoPrintIp, int octoPrintPort, String apiKey)
+    : _api(client, octoPrintIp, octoPrintPort, apiKey), printerStats(_api.printerStats), printJob(_api.printJob) {}
+
+OctoprintPushClient::OctoprintPushClient(Client &client, char *octoPrintUrl, int octoPrintPort, String apiKey)
+    : _api(client, octoPrintUrl, octoPrintPort, apiKey), printerStats(_api.printerStats), printJob(_api.printJob) {}
+
+/** connect()
+ * Logs in passively with the API key to get a session, upgrades the connection to a WebSocket and authenticates it.
+ * */
+bool OctoprintPushClient::connect() {
+  char auth[128];
+  _api._debug = _debug;
+  stop();
+  if (!login(auth, sizeof(auth)) || !upgrade())
+    return false;
+
+  _printerStatisticsHash = 0;
+  _printJobHash          = 0;
+  if (!_socket.sendText(auth)) {
+    stop();
+    return false;
+  }
+  return true;
+}
+
+bool OctoprintPushClient::connected() { return !_socket.closed(); }
+
+void OctoprintPushClient::stop() {
+  if (!_socket.closed())
+    _api._client->stop();
+  _socket.begin(NULL);
+}
+
+/** setThrottle()
+ * Only receive every n-th "current" message, OctoPrint sends one every 500ms by default.
+ * */
+bool OctoprintPushClient::setThrottle(uint8_t throttle) {
+  char message[24];
+  snprintf(message, sizeof(message), "{\"throttle\": %d}", throttle);
+  return _socket.sendText(message);
+}
+
+void OctoprintPushClient::onPrinterStatistics(OctoprintPushCallback callback) { _printerStatisticsCallback = callback; }
+
+void OctoprintPushClient::onPrintJob(OctoprintPushCallback callback) { _printJobCallback = callback; }
+
+/** poll()
+ * Call from loop(). Handles at most one waiting message, returns true if printerStats or printJob changed.
+ * */
+bool OctoprintPushClient::poll() {
+  if (_socket.closed() || !_socket.nextMessage())
+    return false;
+  bool changed = handleMessage();
+  _socket.skipMessage();
+  return changed;
+}
+
+/**
+ * POST /api/login with passive set returns the user name and session the WebSocket needs to authenticate.
+ * */
+bool OctoprintPushClient::login(char *auth, size_t size) {
+  if (!_api.beginRequest(true, "/api/login", "{\"passive\": true}") || _api.httpStatusCode != 200) {
+    _api.endRequest();
+    return false;
+  }
+
+  StaticJsonDocument<64> filter;
+  filter["name"]    = true;
+  filter["session"] = true;
+
+  StaticJsonDocument<256> root;
+  DeserializationError error = deserializeJson(root, _api._body, DeserializationOption::Filter(filter));
+  _api.endRequest();
+  if (error || !root.containsKey("session"))
+    return false;
+
+  snprintf(auth, size, "{\"auth\": \"%s:%s\"}", (const char *)(root["name"] | ""), (const char *)root["session"]);
+  return true;
+}
+
+/**
+ * Standard base64 with padding, out needs room for 4 characters per started 3 bytes and the terminator.
+ * */
+static void base64Encode(const uint8_t *data, size_t length, char *out) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t triple = (uint32_t)data[i] << 16;
+    if (i + 1 < length)
+      triple |= data[i + 1] << 8;
+    if (i + 2 < length)
+      triple |= data[i + 2];
+    *out++ = alphabet[(triple >> 18) & 0x3F];
+    *out++ = alphabet[(triple >> 12) & 0x3F];
+    *out++ = i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+    *out++ = i + 2 < length ? alphabet[triple & 0x3F] : '=';
+  }
+  *out = '\0';
+}
+
+static uint32_t rotateLeft(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+/**
+ * SHA-1 (RFC 3174), only here for the handshake. The message schedule is kept as a 16 word ring to spare the stack.
+ * */
+static void sha1(const uint8_t *data, size_t length, uint8_t digest[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  uint64_t bits = (uint64_t)length * 8;
+  size_t blocks = (length + 8) / 64 + 1;  // the 0x80 marker and the 64 bit length have to fit behind the data
+  for (size_t n = 0; n < blocks; n++) {
+    uint32_t w[16];
+    for (int i = 0; i < 64; i++) {
+      size_t at = n * 64 + i;
+      uint8_t b;
+      if (at < length)
+        b = data[at];
+      else if (at == length)
+        b = 0x80;
+      else if (n == blocks - 1 && i >= 56)
+        b = bits >> ((63 - i) * 8);
+      else
+        b = 0;
+      if ((i & 3) == 0)
+        w[i / 4] = 0;
+      w[i / 4] |= (uint32_t)b << ((3 - (i & 3)) * 8);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      if (i >= 16)
+        w[i & 15] = rotateLeft(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i & 15];
+      e             = d;
+      d             = c;
+      c             = rotateLeft(b, 30);
+      b             = a;
+      a             = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 20; i++)
+    digest[i] = h[i / 4] >> ((3 - (i & 3)) * 8);
+}
+
+/**
+ * Opens a fresh connection and performs the WebSocket opening handshake on it.
+ * */
+bool OctoprintPushClient::upgrade() {
+  uint8_t nonce[16];
+  char key[25];
+  char accept[29];
+  for (int i = 0; i < 16; i++)
+    nonce[i] = random(256);
+  base64Encode(nonce, sizeof(nonce), key);
+  OctoprintWebSocket::acceptKey(key, accept);
+
+  bool reused = true;  // never hand the login connection over to the WebSocket
+  if (!_api.connectToOctoprint(reused))
+    return false;
+
+  OctoprintRequestBuffer upgrade(_api._client, _api.requestWrites);
+  upgrade.println(F("GET /sockjs/websocket HTTP/1.1"));
+  upgrade.print(F("Host: "));
+  if (_api._usingIpAddress)
+    upgrade.println(_api._octoPrintIp);
+  else
+    upgrade.println(_api._octoPrintUrl);
+  upgrade.println(F("Upgrade: websocket"));
+  upgrade.println(F("Connection: Upgrade"));
+  upgrade.print(F("Sec-WebSocket-Key: "));
+  upgrade.println(key);
+  upgrade.println(F("Sec-WebSocket-Version: 13"));
+  upgrade.print(F("User-Agent: "));
+  upgrade.println(F(USER_AGENT));
+  upgrade.println();
+  if (!upgrade.send()) {
+    _api._client->stop();
+    return false;
+  }
+
+  _api._response.reset();
+  unsigned long now = millis();
+  while (!_api.readResponseHeaders(64) && millis() - now < OPAPI_TIMEOUT)
+    ;
+  if (!_api._response.finished() || _api._response.statusCode != 101) {
+    if (_debug) {
+      Serial.print("OctoprintPushClient::upgrade() failed, HTTP status: ");
+      Serial.println(_api._response.statusCode);
+    }
+    _api._client->stop();
+    return false;
+  }
+  if (strcmp(_api._response.websocketAccept, accept) != 0) {  // something answered 101 that did not read our key
+    if (_debug)
+      Serial.println("OctoprintPushClient::upgrade() failed, wrong Sec-WebSocket-Accept");
+    _api._client->stop();
+    return false;
+  }
+  _socket.begin(_api._client);
+  return true;
+}
+
+/** handleMessage()
+ * Streams one message off the socket, keeping only the parts of a "current" message the structs need.
+ * Every other message type (connected, history, event, plugin...) is read through and dropped.
+ * */
+bool OctoprintPushClient::handleMessage() {
+  StaticJsonDocument<384> filter;
+  JsonObject wanted     = filter.createNestedObject("current");
+  wanted["state"]       = true;
+  wanted["job"]         = true;
+  wanted["progress"]    = true;
+  JsonObject sensors    = wanted.createNestedArray("temps").createNestedObject();
+  sensors["bed"]        = true;
+  sensors["chamber"]    = true;
+  char tool[8];
+  for (int i = 0; i < OPAPI_MAX_TOOLS; i++) {
+    snprintf(tool, sizeof(tool), "tool%d", i);
+    sensors[tool] = true;  // not "time", it changes with every sample and would defeat the hash below
+  }
+
+  StaticJsonDocument<JSONDOCUMENT_SIZE> root;
+  DeserializationError error = deserializeJson(root, _socket, DeserializationOption::Filter(filter));
+  if (error || !root.containsKey("current")) {
+    if (_debug && error) {
+      Serial.print("OctoprintPushClient::handleMessage() ");
+      Serial.println(error.c_str());
+    }
+    return false;
+  }
+  JsonObject current = root["current"];
+
+  // Hash what each struct is built from, so the callbacks only fire when something really changed.
+  OctoprintHashPrint printerHash;
+  serializeJson(current["state"], printerHash);
+  serializeJson(current["temps"], printerHash);
+  OctoprintHashPrint jobHash;
+  serializeJson(current["job"], jobHash);
+  serializeJson(current["progress"], jobHash);
+
+  bool changed = false;
+  if (printerHash.hash() != _printerStatisticsHash) {
+    _printerStatisticsHash = printerHash.hash();
+    _api.parsePrinterState(current["state"]);
+    JsonArray temps = current["temps"];
+    if (temps.size() > 0)
+      _api.parseTemperatures(temps[temps.size() - 1]);  // the newest sample comes last
+    changed = true;
+    if (_printerStatisticsCallback)
+      _printerStatisticsCallback(this);
+  }
+  if (jobHash.hash() != _printJobHash) {
+    _printJobHash = jobHash.hash();
+    _api.parsePrintJob(current);
+    printJob.printerState = (const char *)(current["state"]["text"] | "");
+    changed               = true;
+    if (_printJobCallback)
+      _printJobCallback(this);
+  }
+  return changed;
+}
+
+/***** WEBSOCKET FRAMING *****/
+/**
+ * Minimal RFC 6455 client framing. Message payloads are read as a Stream, continuation frames are followed
+ * transparently and control frames in between are answered (ping) or honoured (close) on the way.
+ * */
+enum {
+  OPWS_CONTINUATION = 0x0,
+  OPWS_TEXT         = 0x1,
+  OPWS_BINARY       = 0x2,
+  OPWS_CLOSE        = 0x8,
+  OPWS_PING         = 0x9,
+  OPWS_PONG         = 0xA
+};
+
+enum {
+  OPWS_FRAME_ERROR,
+  OPWS_FRAME_CONTROL,
+  OPWS_FRAME_DATA
+};
+
+void OctoprintWebSocket::begin(Client *client) {
+  _client    = client;
+  _closed    = client == NULL;
+  _inMessage = false;
+  _remaining = 0;
+  _final     = true;
+  setTimeout(OPAPI_TIMEOUT);
+}
+
+bool OctoprintWebSocket::closed() {
+  if (!_closed && !_client->available() && !_client->connected())
+    _closed = true;
+  return _closed;
+}
+
+/** nextMessage()
+ * Returns true when the start of a text or binary message is waiting, never waits for one to arrive.
+ * */
+bool OctoprintWebSocket::nextMessage() {
+  if (_inMessage)
+    skipMessage();
+  while (!_closed && _client->available()) {
+    uint8_t frame = readFrameHeader();
+    if (frame == OPWS_FRAME_ERROR)
+      return false;
+    if (frame == OPWS_FRAME_CONTROL)
+      continue;
+    if (_opcode == OPWS_TEXT || _opcode == OPWS_BINARY) {
+      _inMessage = true;
+      return true;
+    }
+    // a continuation without a start, skip it
+    _inMessage = true;
+    skipMessage();
+  }
+  return false;
+}
+
+void OctoprintWebSocket::skipMessage() {
+  unsigned long now = millis();
+  while (_inMessage && !_closed && millis() - now < OPAPI_TIMEOUT) {
+    if (read() >= 0)
+      now = millis();
+  }
+  _inMessage = false;
+}
+
+int OctoprintWebSocket::timedByte() {
+  unsigned long now = millis();
+  while (!_client->available()) {
+    if (millis() - now >= OPAPI_TIMEOUT || !_client->connected())
+      return -1;
+    yield();
+  }
+  return _client->read();
+}
+
+/**
+ * Reads a frame header (the bytes of a header arrive together, so this only waits once one has started).
+ * Control frames are handled completely here, for data frames the payload is left for read().
+ * */
+uint8_t OctoprintWebSocket::readFrameHeader() {
+  int b0 = timedByte();
+  int b1 = timedByte();
+  if (b0 < 0 || b1 < 0) {
+    _closed = true;
+    return OPWS_FRAME_ERROR;
+  }
+  uint8_t opcode       = b0 & 0x0F;
+  bool masked          = b1 & 0x80;
+  unsigned long length = b1 & 0x7F;
+  uint8_t mask[4]      = {0, 0, 0, 0};
+
+  int extended = length == 126 ? 2 : (length == 127 ? 8 : 0);
+  if (extended)
+    length = 0;
+  for (int i = 0; i < extended; i++) {
+    int b = timedByte();
+    if (b < 0 || (extended == 8 && i < 4 && b != 0)) {  // nothing on a microcontroller needs a 4GB message
+      _closed = true;
+      return OPWS_FRAME_ERROR;
+    }
+    length = (length << 8) | b;
+  }
+  for (int i = 0; masked && i < 4; i++) {
+    int b = timedByte();
+    if (b < 0) {
+      _closed = true;
+      return OPWS_FRAME_ERROR;
+    }
+    mask[i] = b;
+  }
+
+  if (opcode < OPWS_CLOSE) {
+    _opcode    = opcode;
+    _final     = b0 & 0x80;
+    _masked    = masked;
+    _maskIndex = 0;
+    _remaining = length;
+    memcpy(_mask, mask, sizeof(mask));
+    return OPWS_FRAME_DATA;
+  }
+
+  // Control frames may arrive between the fragments of a message, so they must not touch its state.
+  uint8_t payload[OPPUSH_CONTROL_SIZE];
+  size_t received = 0;
+  for (unsigned long i = 0; i < length; i++) {
+    int b = timedByte();
+    if (b < 0) {
+      _closed = true;
+      return OPWS_FRAME_ERROR;
+    }
+    if (received < sizeof(payload))
+      payload[received++] = b ^ mask[i & 3];
+  }
+  if (opcode == OPWS_PING)
+    sendFrame(OPWS_PONG, payload, received);
+  else if (opcode == OPWS_CLOSE) {
+    sendFrame(OPWS_CLOSE, payload, received < 2 ? received : 2);
+    _client->stop();
+    _closed = true;
+    return OPWS_FRAME_ERROR;
+  }
+  return OPWS_FRAME_CONTROL;
+}
+
+int OctoprintWebSocket::available() {
+  if (!_inMessage || _closed)
+    return 0;
+  if (_remaining == 0)
+    return _final ? 0 : _client->available() > 0;
+  unsigned long n = _client->available();
+  return n > _remaining ? _remaining : n;
+}
+
+int OctoprintWebSocket::read() {
+  if (!_inMessage || _closed)
+    return -1;
+  while (_remaining == 0) {
+    if (_final) {
+      _inMessage = false;
+      return -1;
+    }
+    if (!_client->available())
+      return -1;
+    uint8_t frame = readFrameHeader();
+    if (frame == OPWS_FRAME_ERROR)
+      return -1;
+    if (frame == OPWS_FRAME_DATA && _opcode != OPWS_CONTINUATION) {
+      _closed = true;  // a new message inside a fragmented one is a protocol error
+      _client->stop();
+      return -1;
+    }
+  }
+  if (!_client->available())
+    return -1;
+  int c = _client->read();
+  if (c < 0)
+    return -1;
+  _remaining--;
+  if (_masked)
+    c ^= _mask[_maskIndex++ & 3];
+  return c;
+}
+
+int OctoprintWebSocket::peek() {
+  // continuation headers are only crossed by read(), which is all ArduinoJson needs past a frame boundary
+  if (!_inMessage || _closed || _remaining == 0 || !_client->available())
+    return -1;
+  int c = _client->peek();
+  if (c >= 0 && _masked)
+    c ^= _mask[_maskIndex & 3];
+  return c;
+}
+
+size_t OctoprintWebSocket::write(uint8_t) { return 0; }
+
+void OctoprintWebSocket::flush() {}
+
+bool OctoprintWebSocket::sendText(const char *text) {
+  if (closed())
+    return false;
+  return sendFrame(OPWS_TEXT, (const uint8_t *)text, strlen(text));
+}
+
+/** acceptKey()
+ * The Sec-WebSocket-Accept a server has to answer a Sec-WebSocket-Key with: base64(SHA-1(key + RFC 6455 GUID)).
+ * accept needs room for 29 characters.
+ * */
+void OctoprintWebSocket::acceptKey(const char *key, char *accept) {
+  static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  char keyed[64];
+  uint8_t digest[20];
+  size_t length = snprintf(keyed, sizeof(keyed), "%s%s", key, guid);
+  if (length >= sizeof(keyed))
+    length = sizeof(keyed) - 1;
+  sha1((const uint8_t *)keyed, length, digest);
+  base64Encode(digest, sizeof(digest), accept);
+}
+
+/**
+ * Client frames always have to be masked. Header and masked payload are gathered in a request buffer, so a frame
+ * that fits goes out in one write; anything longer than a 16 bit length is refused.
+ * */
+bool OctoprintWebSocket::sendFrame(uint8_t opcode, const uint8_t *payload, size_t length) {
+  if (length > OPPUSH_FRAME_SIZE)
+    return false;
+  OctoprintRequestBuffer frame(_client, _writes);
+  frame.write(0x80 | opcode);
+  if (length < 126)
+    frame.write(0x80 | length);
+  else {
+    frame.write(0x80 | 126);
+    frame.write((length >> 8) & 0xFF);
+    frame.write(length & 0xFF);
+  }
+  uint8_t mask[4];
+  for (int i = 0; i < 4; i++)
+    frame.write(mask[i] = random(256));
+  for (size_t i = 0; i < length; i++)
+    frame.write(payload[i] ^ mask[i & 3]);
+  return frame.send();
+}
@@ -0,0 +1,80 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintPushClient_h
+#define OctoprintPushClient_h
+
+#include "OctoPrintAPI.h"
+
+#define OPPUSH_CONTROL_SIZE 125  // largest WebSocket control frame payload
+#define OPPUSH_FRAME_SIZE 65535   // largest frame sendText() sends, a 16 bit length
+
+class OctoprintWebSocket : public Stream {
+ public:
+  void begin(Client *client);
+  bool nextMessage();
+  void skipMessage();
+  bool sendText(const char *text);
+  bool closed();
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t);
+  void flush();
+  static void acceptKey(const char *key, char *accept);
+
+ private:
+  Client *_client = NULL;
+  unsigned long _writes = 0;
+  unsigned long _remaining;
+  bool _final;
+  bool _inMessage;
+  bool _closed = true;
+  bool _masked;
+  uint8_t _mask[4];
+  uint8_t _maskIndex;
+  uint8_t _opcode;
+  int timedByte();
+  uint8_t readFrameHeader();
+  bool sendFrame(uint8_t opcode, const uint8_t *payload, size_t length);
+};
+
+class OctoprintPushClient;
+typedef void (*OctoprintPushCallback)(OctoprintPushClient *push);
+
+class OctoprintPushClient {
+ private:
+  OctoprintApi _api;  // constructed before printerStats and printJob, which refer into it
+
+ public:
+  OctoprintPushClient(Client &client, IPAddress octoPrintIp, int octoPrintPort, String apiKey);
+  OctoprintPushClient(Client &client, char *octoPrintUrl, int octoPrintPort, String apiKey);
+  bool connect();
+  bool connected();
+  void stop();
+  bool poll();
+  bool setThrottle(uint8_t throttle);
+  void onPrinterStatistics(OctoprintPushCallback callback);
+  void onPrintJob(OctoprintPushCallback callback);
+  printerStatistics &printerStats;
+  printJobCall &printJob;
+  bool _debug = false;
+
+ private:
+  OctoprintWebSocket _socket;
+  OctoprintPushCallback _printerStatisticsCallback = NULL;
+  OctoprintPushCallback _printJobCallback          = NULL;
+  uint32_t _printerStatisticsHash                  = 0;
+  uint32_t _printJobHash                           = 0;
+  bool login(char *auth, size_t size);
+  bool upgrade();
+  bool handleMessage();
+};
+
+#endif
@@ -0,0 +1,151 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintScheduler.h"
+
+/** OctoprintScheduler
+ * Decides when printerStats and printJob are worth refreshing, instead of polling both at a fixed rate.
+ * printerStats is polled every OPSCHED_FAST ms while a heater is still warming up, every OPSCHED_NORMAL ms while
+ * printing and every OPSCHED_SLOW ms otherwise. printJob follows the same steps, fast over the last
+ * OPSCHED_ENDING_TIME seconds of a print. When OctoPrint cannot be reached both back off, doubling from
+ * OPSCHED_NORMAL up to OPSCHED_MAX_BACKOFF, and go back to normal with the first answer.
+ * Requests run through the non-blocking API, so tick() never waits on the network.
+ * */
+OctoprintScheduler::OctoprintScheduler(OctoprintApi &api) : _api(api) {
+  _fast     = OPSCHED_FAST;
+  _normal   = OPSCHED_NORMAL;
+  _slow     = OPSCHED_SLOW;
+  _running  = 0;
+  _failures = 0;
+  refreshNow();
+}
+
+void OctoprintScheduler::setIntervals(unsigned long fast, unsigned long normal, unsigned long slow) {
+  _fast   = fast;
+  _normal = normal;
+  _slow   = slow;
+}
+
+/** refreshNow()
+ * Makes both endpoints due on the next tick(), e.g. after sending a command.
+ * */
+void OctoprintScheduler::refreshNow() { _due[0] = _due[1] = millis(); }
+
+/** online()
+ * False while OctoPrint is not answering and the scheduler is backing off.
+ * */
+bool OctoprintScheduler::online() { return _failures == 0; }
+
+/** nextPoll()
+ * ms until the next request is due, 0 while one is running or overdue. Handy for sleeping between ticks.
+ * */
+unsigned long OctoprintScheduler::nextPoll() {
+  if (_running)
+    return 0;
+  unsigned long now  = millis();
+  unsigned long wait = 0xFFFFFFFFUL;
+  for (uint8_t i = 0; i < 2; i++) {
+    long left = (long)(_due[i] - now);
+    if (left <= 0)
+      return 0;
+    if ((unsigned long)left < wait)
+      wait = left;
+  }
+  return wait;
+}
+
+/** tick()
+ * Call from loop(). Returns OPSCHED_PRINTER_STATISTICS and/or OPSCHED_PRINT_JOB when that struct has just been
+ * refreshed with new content, 0 otherwise.
+ * */
+uint8_t OctoprintScheduler::tick() {
+  if (_running) {
+    if (_api.poll())
+      return 0;
+    uint8_t endpoint = _running;
+    _running         = 0;
+    return finish(endpoint);
+  }
+
+  unsigned long now = millis();
+  if ((long)(now - _due[0]) >= 0)
+    start(OPSCHED_PRINTER_STATISTICS);
+  else if ((long)(now - _due[1]) >= 0)
+    start(OPSCHED_PRINT_JOB);
+  return 0;
+}
+
+bool OctoprintScheduler::start(uint8_t endpoint) {
+  bool started = endpoint == OPSCHED_PRINTER_STATISTICS ? _api.beginGetPrinterStatistics() : _api.beginGetPrintJob();
+  if (started)
+    _running = endpoint;
+  else if (!_api.requestInProgress())
+    backOff(millis());  // the connect failed
+  return started;  // otherwise the OctoprintApi is busy with a request of its own, try again next tick
+}
+
+uint8_t OctoprintScheduler::finish(uint8_t endpoint) {
+  unsigned long now = millis();
+  uint8_t index     = endpoint == OPSCHED_PRINTER_STATISTICS ? 0 : 1;
+
+  if (!_api.requestSucceeded()) {
+    backOff(now);
+    return 0;
+  }
+
+  _failures   = 0;
+  _due[index] = now + (index == 0 ? printerInterval() : jobInterval());
+  // A print that just started (or is about to end) should not wait out the idle interval of printJob.
+  if (index == 0 && (long)(now + jobInterval() - _due[1]) < 0)
+    _due[1] = now + jobInterval();
+  return _api.requestChanged() ? endpoint : 0;
+}
+
+/** backOff()
+ * One more failure in a row: both endpoints wait _normal ms, doubled for every earlier failure up to OPSCHED_MAX_BACKOFF.
+ * */
+void OctoprintScheduler::backOff(unsigned long now) {
+  if (_failures < 16)
+    _failures++;
+  unsigned long backoff = _normal;
+  for (uint8_t i = 1; i < _failures && backoff < OPSCHED_MAX_BACKOFF; i++)
+    backoff *= 2;
+  if (backoff > OPSCHED_MAX_BACKOFF)
+    backoff = OPSCHED_MAX_BACKOFF;
+  _due[0] = _due[1] = now + backoff;
+}
+
+bool OctoprintScheduler::heating() {
+  printerStatistics &stats = _api.printerStats;
+  if (stats.printerBedAvailable && stats.printerBedTempTarget > 0 &&
+      stats.printerBedTempActual < stats.printerBedTempTarget - OPSCHED_HEATING_MARGIN)
+    return true;
+  for (uint8_t i = 0; i < stats.printerToolCount; i++) {
+    if (stats.printerToolTempTarget[i] > 0 && stats.printerToolTempActual[i] < stats.printerToolTempTarget[i] - OPSCHED_HEATING_MARGIN)
+      return true;
+  }
+  return false;
+}
+
+unsigned long OctoprintScheduler::printerInterval() {
+  if (!_api.printerStats.printerStateoperational)
+    return _slow;
+  if (heating())
+    return _fast;
+  return _api.printerStats.printerStatePrinting ? _normal : _slow;
+}
+
+unsigned long OctoprintScheduler::jobInterval() {
+  if (!_api.printerStats.printerStatePrinting && !_api.printerStats.printerStatepaused)
+    return _slow;
+  long left = _api.printJob.progressPrintTimeLeft;
+  if (_api.printerStats.printerStatePrinting && ((left > 0 && left <= OPSCHED_ENDING_TIME) || _api.printJob.progressCompletion >= 99))
+    return _fast;
+  return _normal;
+}
@@ -0,0 +1,60 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintScheduler_h
+#define OctoprintScheduler_h
+
+#include "OctoPrintAPI.h"
+
+#ifndef OPSCHED_FAST
+#define OPSCHED_FAST 2000  // ms between polls while heating or close to the end of a print
+#endif
+#ifndef OPSCHED_NORMAL
+#define OPSCHED_NORMAL 10000  // while printing
+#endif
+#ifndef OPSCHED_SLOW
+#define OPSCHED_SLOW 60000  // while idle or disconnected from the printer
+#endif
+#ifndef OPSCHED_MAX_BACKOFF
+#define OPSCHED_MAX_BACKOFF 300000  // longest wait between retries while OctoPrint cannot be reached
+#endif
+#define OPSCHED_HEATING_MARGIN 3  // a heater this many degrees below its target is still heating up
+#define OPSCHED_ENDING_TIME    300  // seconds left that count as close to the end of a print
+
+enum {
+  OPSCHED_PRINTER_STATISTICS = 1,
+  OPSCHED_PRINT_JOB          = 2
+};
+
+class OctoprintScheduler {
+ public:
+  OctoprintScheduler(OctoprintApi &api);
+  void setIntervals(unsigned long fast, unsigned long normal, unsigned long slow);
+  uint8_t tick();
+  void refreshNow();
+  bool online();
+  unsigned long nextPoll();
+
+ private:
+  OctoprintApi &_api;
+  unsigned long _fast;
+  unsigned long _normal;
+  unsigned long _slow;
+  unsigned long _due[2];
+  uint8_t _running;
+  uint8_t _failures;
+  bool start(uint8_t endpoint);
+  uint8_t finish(uint8_t endpoint);
+  void backOff(unsigned long now);
+  bool heating();
+  unsigned long printerInterval();
+  unsigned long jobInterval();
+};
+
+#endif
@@ -0,0 +1,106 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintTemperatureHistory.h"
+
+/** OctoprintTemperatureHistory
+ * Keeps the last OPAPI_HISTORY_SIZE temperature samples of the bed and the first OPAPI_HISTORY_TOOLS tools in a ring
+ * buffer, e.g. to draw a graph. The first update() fills it from the server's own history, later ones only ask for
+ * the samples taken since the previous call and append the ones newer than the last stored timestamp.
+ * The history array is read one sample at a time straight off the socket, so memory use does not grow with it.
+ * Sample 0 is the oldest, count() - 1 the newest.
+ * */
+OctoprintTemperatureHistory::OctoprintTemperatureHistory(OctoprintApi &api) : _api(api) { clear(); }
+
+void OctoprintTemperatureHistory::clear() {
+  _first = 0;
+  _count = 0;
+}
+
+bool OctoprintTemperatureHistory::update() {
+  // OctoPrint samples at most every two seconds, so one per second since the last update never misses any.
+  long limit = OPAPI_HISTORY_SIZE;
+  if (_count > 0) {
+    limit = (millis() - _lastUpdate) / 1000 + 2;
+    if (limit > OPAPI_HISTORY_SIZE)
+      limit = OPAPI_HISTORY_SIZE;
+  }
+  char command[64];
+  snprintf(command, sizeof(command), "/api/printer?history=true&limit=%ld&exclude=state,sd", limit);
+
+  if (!_api.beginGetToOctoprint(command))
+    return false;
+
+  StaticJsonDocument<192> filter;
+  filter["time"]          = true;
+  filter["bed"]["actual"] = true;
+  filter["bed"]["target"] = true;
+  char tool[8];
+  for (int i = 0; i < OPAPI_HISTORY_TOOLS; i++) {
+    snprintf(tool, sizeof(tool), "tool%d", i);
+    filter[tool]["actual"] = true;
+    filter[tool]["target"] = true;
+  }
+
+  bool success = _api._body.find((char *)"\"history\"");
+  while (success && _api.nextElement()) {
+    StaticJsonDocument<256> sample;
+    DeserializationError error = deserializeJson(sample, _api._body, DeserializationOption::Filter(filter));
+    if (error) {
+      if (_api._debug) {
+        Serial.print("OctoprintTemperatureHistory::update() ");
+        Serial.println(error.c_str());
+      }
+      success = false;
+    } else if (_count == 0 || (long)sample["time"] > time(_count - 1))
+      append(sample.as<JsonObject>());
+  }
+  _api.endRequest();
+
+  if (success)
+    _lastUpdate = millis();
+  return success;
+}
+
+void OctoprintTemperatureHistory::append(JsonObject sample) {
+  uint16_t i;
+  if (_count < OPAPI_HISTORY_SIZE)
+    i = slot(_count++);
+  else {
+    i      = _first;  // full, the oldest sample makes room
+    _first = slot(1);
+  }
+  _time[i]      = sample["time"];
+  _bedActual[i] = sample["bed"]["actual"];
+  _bedTarget[i] = sample["bed"]["target"];
+  char tool[8];
+  for (int t = 0; t < OPAPI_HISTORY_TOOLS; t++) {
+    snprintf(tool, sizeof(tool), "tool%d", t);
+    _toolActual[t][i] = sample[tool]["actual"];
+    _toolTarget[t][i] = sample[tool]["target"];
+  }
+}
+
+uint16_t OctoprintTemperatureHistory::slot(uint16_t sample) { return (_first + sample) % OPAPI_HISTORY_SIZE; }
+
+uint16_t OctoprintTemperatureHistory::count() { return _count; }
+
+long OctoprintTemperatureHistory::time(uint16_t sample) { return sample < _count ? _time[slot(sample)] : 0; }
+
+float OctoprintTemperatureHistory::bedActual(uint16_t sample) { return sample < _count ? _bedActual[slot(sample)] : 0; }
+
+float OctoprintTemperatureHistory::bedTarget(uint16_t sample) { return sample < _count ? _bedTarget[slot(sample)] : 0; }
+
+float OctoprintTemperatureHistory::toolActual(uint8_t tool, uint16_t sample) {
+  return tool < OPAPI_HISTORY_TOOLS && sample < _count ? _toolActual[tool][slot(sample)] : 0;
+}
+
+float OctoprintTemperatureHistory::toolTarget(uint8_t tool, uint16_t sample) {
+  return tool < OPAPI_HISTORY_TOOLS && sample < _count ? _toolTarget[tool][slot(sample)] : 0;
+}
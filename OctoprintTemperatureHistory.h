@@ -0,0 +1,48 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintTemperatureHistory_h
+#define OctoprintTemperatureHistory_h
+
+#include "OctoPrintAPI.h"
+
+#ifndef OPAPI_HISTORY_SIZE
+#define OPAPI_HISTORY_SIZE 60  // samples kept per heater, OctoPrint takes one every 2 to 5 seconds
+#endif
+#ifndef OPAPI_HISTORY_TOOLS
+#define OPAPI_HISTORY_TOOLS 1  // tools recorded next to the bed, tool0 to tool(OPAPI_HISTORY_TOOLS - 1)
+#endif
+
+class OctoprintTemperatureHistory {
+ public:
+  OctoprintTemperatureHistory(OctoprintApi &api);
+  bool update();
+  void clear();
+  uint16_t count();
+  long time(uint16_t sample);
+  float bedActual(uint16_t sample);
+  float bedTarget(uint16_t sample);
+  float toolActual(uint8_t tool, uint16_t sample);
+  float toolTarget(uint8_t tool, uint16_t sample);
+
+ private:
+  OctoprintApi &_api;
+  uint16_t _first;
+  uint16_t _count;
+  unsigned long _lastUpdate;
+  long _time[OPAPI_HISTORY_SIZE];
+  float _bedActual[OPAPI_HISTORY_SIZE];
+  float _bedTarget[OPAPI_HISTORY_SIZE];
+  float _toolActual[OPAPI_HISTORY_TOOLS][OPAPI_HISTORY_SIZE];
+  float _toolTarget[OPAPI_HISTORY_TOOLS][OPAPI_HISTORY_SIZE];
+  uint16_t slot(uint16_t sample);
+  void append(JsonObject sample);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "OctoprintWorker.h"
+
+#if defined(ESP32) || defined(OPAPI_WORKER_THREADS)
+
+/** OctoprintWorker
+ * Runs an OctoprintApi on a task of its own, e.g. networking on core 0 while the display runs on core 1.
+ * The worker refreshes printerSnapshot and jobSnapshot every interval ms and executes the commands queued with send()
+ * in between. Results are published through a sequence lock: read() never blocks the worker and only copies again in
+ * the rare case a publish happened halfway through, so it never returns a half updated snapshot.
+ * Once begin() has been called the OctoprintApi and its Client belong to the worker, do not use them elsewhere.
+ * */
+OctoprintWorker::OctoprintWorker(OctoprintApi &api) : _api(api), _interval(5000), _sequence(0), _online(false) {
+  memset(&_printer, 0, sizeof(_printer));
+  memset(&_job, 0, sizeof(_job));
+}
+
+#if defined(ESP32)
+/**
+ * The queue is created once and never deleted, so a send() from another task racing end() only lands in a queue
+ * nobody reads until the next begin().
+ * */
+bool OctoprintWorker::begin(unsigned long interval, int core) {
+  if (_task != NULL)
+    return false;
+  _interval = interval;
+  if (_queue == NULL)
+    _queue = xQueueCreate(OPWORKER_QUEUE_LENGTH, sizeof(workerCommand));
+  if (_queue == NULL)
+    return false;
+  xQueueReset(_queue);  // commands sent while stopped are stale
+  if (xTaskCreatePinnedToCore(task, "octoprint", OPWORKER_STACK_SIZE, this, 1, &_task, core) != pdPASS) {
+    _task = NULL;
+    return false;
+  }
+  return true;
+}
+
+/** end()
+ * Drops the queued commands, lets the worker finish what it is doing and waits for its task to stop.
+ * Not to be called from the worker's own task.
+ * */
+void OctoprintWorker::end() {
+  if (_task == NULL)
+    return;
+  workerCommand stop;
+  stop.command  = OPWORKER_STOP;
+  stop.gcode[0] = '\0';
+  _stopper      = xTaskGetCurrentTaskHandle();
+  xQueueReset(_queue);
+  xQueueSend(_queue, &stop, portMAX_DELAY);  // other tasks may have filled it again, the worker makes room
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  _task = NULL;
+}
+
+void OctoprintWorker::task(void *worker) {
+  OctoprintWorker *self = (OctoprintWorker *)worker;
+  self->run();
+  xTaskNotifyGive(self->_stopper);  // end() may return and the worker go away from here on
+  vTaskDelete(NULL);
+}
+
+bool OctoprintWorker::send(uint8_t command, const char *gcode) {
+  if (_queue == NULL)
+    return false;
+  workerCommand queued;
+  queued.command = command;
+  snprintf(queued.gcode, sizeof(queued.gcode), "%s", gcode != NULL ? gcode : "");
+  return xQueueSend(_queue, &queued, 0) == pdTRUE;
+}
+
+bool OctoprintWorker::receive(workerCommand &command, unsigned long wait) {
+  return xQueueReceive(_queue, &command, pdMS_TO_TICKS(wait)) == pdTRUE;
+}
+#else
+bool OctoprintWorker::begin(unsigned long interval, int) {
+  if (_thread.joinable())
+    return false;
+  _interval = interval;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.clear();  // commands sent while stopped are stale
+  }
+  _thread = std::thread(&OctoprintWorker::run, this);
+  return true;
+}
+
+/** end()
+ * Drops the queued commands, lets the worker finish what it is doing and waits for its thread to stop.
+ * */
+void OctoprintWorker::end() {
+  if (!_thread.joinable())
+    return;
+  workerCommand stop;
+  stop.command  = OPWORKER_STOP;
+  stop.gcode[0] = '\0';
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.clear();
+    _queue.push_back(stop);  // in the same lock, a send() from another thread cannot take its place
+  }
+  _wake.notify_one();
+  _thread.join();
+}
+
+bool OctoprintWorker::send(uint8_t command, const char *gcode) {
+  workerCommand queued;
+  queued.command = command;
+  snprintf(queued.gcode, sizeof(queued.gcode), "%s", gcode != NULL ? gcode : "");
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_queue.size() >= OPWORKER_QUEUE_LENGTH)
+      return false;
+    _queue.push_back(queued);
+  }
+  _wake.notify_one();
+  return true;
+}
+
+bool OctoprintWorker::receive(workerCommand &command, unsigned long wait) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (!_wake.wait_for(lock, std::chrono::milliseconds(wait), [this] { return !_queue.empty(); }))
+    return false;
+  command = _queue.front();
+  _queue.pop_front();
+  return true;
+}
+#endif
+
+/** refresh()
+ * Asks for a refresh right away instead of at the end of the interval, e.g. after pressing a button.
+ * */
+bool OctoprintWorker::refresh() { return send(OPWORKER_REFRESH); }
+
+void OctoprintWorker::run() {
+  unsigned long last = millis();
+  update();
+  for (;;) {
+    unsigned long elapsed = millis() - last;
+    workerCommand command;
+    if (receive(command, elapsed < _interval ? _interval - elapsed : 0)) {
+      if (command.command == OPWORKER_STOP)
+        return;
+      execute(command);
+      if (command.command != OPWORKER_REFRESH)
+        continue;  // commands change the state, but the next regular refresh picks that up
+    }
+    last = millis();
+    update();
+  }
+}
+
+void OctoprintWorker::execute(const workerCommand &command) {
+  switch (command.command) {
+    case OPWORKER_JOB_START:
+      _api.octoPrintJobStart();
+      break;
+    case OPWORKER_JOB_CANCEL:
+      _api.octoPrintJobCancel();
+      break;
+    case OPWORKER_JOB_PAUSE:
+      _api.octoPrintJobPause();
+      break;
+    case OPWORKER_JOB_RESUME:
+      _api.octoPrintJobResume();
+      break;
+    case OPWORKER_GCODE:
+      _api.octoPrintPrinterCommand((char *)command.gcode);
+      break;
+  }
+}
+
+void OctoprintWorker::update() {
+  printerSnapshot printer;
+  jobSnapshot job;
+  bool online = _api.getPrinterSnapshot(printer);
+  if (online && !_api.getJobSnapshot(job))
+    online = false;
+  if (online)
+    publish(printer, job, true);
+  else
+    _online = false;  // keep the last good snapshot for the display
+}
+
+void OctoprintWorker::publish(const printerSnapshot &printer, const jobSnapshot &job, bool online) {
+  uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+  _sequence.store(sequence + 1, std::memory_order_relaxed);  // odd while writing
+  std::atomic_thread_fence(std::memory_order_release);
+  _printer = printer;
+  _job     = job;
+  std::atomic_thread_fence(std::memory_order_release);
+  _sequence.store(sequence + 2, std::memory_order_release);
+  _online = online;
+}
+
+/** read()
+ * Copies the latest snapshots, false until the first refresh has succeeded. Safe to call from any task.
+ * */
+bool OctoprintWorker::read(printerSnapshot &printer, jobSnapshot &job) {
+  uint32_t before;
+  do {
+    before = _sequence.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;  // a publish is in progress, it only takes a copy of two structs
+    printer = _printer;
+    job     = _job;
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((before & 1) || before != _sequence.load(std::memory_order_relaxed));
+  return before > 0;
+}
+
+/** updates()
+ * Number of snapshots published so far, cheap to compare against to see whether read() has something new.
+ * */
+uint32_t OctoprintWorker::updates() { return _sequence.load(std::memory_order_acquire) / 2; }
+
+/** online()
+ * Whether the last refresh reached OctoPrint, read() keeps returning the last good snapshot while it does not.
+ * */
+bool OctoprintWorker::online() { return _online; }
+
+#endif
@@ -0,0 +1,90 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#ifndef OctoprintWorker_h
+#define OctoprintWorker_h
+
+#include "OctoPrintAPI.h"
+
+// FreeRTOS on the ESP32, std::thread elsewhere when OPAPI_WORKER_THREADS is defined (e.g. a PC build).
+#if defined(ESP32) || defined(OPAPI_WORKER_THREADS)
+
+#include <atomic>
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifndef OPWORKER_STACK_SIZE
+#define OPWORKER_STACK_SIZE 8192
+#endif
+#ifndef OPWORKER_QUEUE_LENGTH
+#define OPWORKER_QUEUE_LENGTH 8
+#endif
+#define OPWORKER_GCODE_SIZE 48
+
+enum OctoprintWorkerCommand {
+  OPWORKER_REFRESH,
+  OPWORKER_JOB_START,
+  OPWORKER_JOB_CANCEL,
+  OPWORKER_JOB_PAUSE,
+  OPWORKER_JOB_RESUME,
+  OPWORKER_GCODE,
+  OPWORKER_STOP
+};
+
+struct workerCommand {
+  uint8_t command;
+  char gcode[OPWORKER_GCODE_SIZE];
+};
+
+class OctoprintWorker {
+ public:
+  OctoprintWorker(OctoprintApi &api);
+  bool begin(unsigned long interval = 5000, int core = 0);
+  void end();
+  bool send(uint8_t command, const char *gcode = NULL);
+  bool refresh();
+  bool read(printerSnapshot &printer, jobSnapshot &job);
+  uint32_t updates();
+  bool online();
+
+ private:
+  OctoprintApi &_api;
+  unsigned long _interval;
+  std::atomic<uint32_t> _sequence;
+  std::atomic<bool> _online;
+  printerSnapshot _printer;
+  jobSnapshot _job;
+#if defined(ESP32)
+  QueueHandle_t _queue  = NULL;
+  TaskHandle_t _task    = NULL;
+  TaskHandle_t _stopper = NULL;  // the task waiting in end()
+  static void task(void *worker);
+#else
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::deque<workerCommand> _queue;
+#endif
+  bool receive(workerCommand &command, unsigned long wait);
+  void run();
+  void execute(const workerCommand &command);
+  void update();
+  void publish(const printerSnapshot &printer, const jobSnapshot &job, bool online);
+};
+
+#endif
+#endif
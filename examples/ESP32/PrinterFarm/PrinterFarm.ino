@@ -0,0 +1,77 @@
+/*******************************************************************
+ *  Keep a whole bank of OctoPrint printers up to date from one
+ *  ESP32 with OctoprintFarm. Printers are refreshed side by side,
+ *  one per client in the pool, so a full refresh takes about as
+ *  long as the slowest printer rather than all of them added up.
+ *
+ *  You will need the IP or hostname of each OctoPrint server, a
+ *  port number (will be 80 unless you are reaching it from an
+ *  external source) and an API key from each OctoPrint
+ *  installation - http://docs.octoprint.org/en/master/api/general.html#authorization
+ *  You will also need to enable CORS - http://docs.octoprint.org/en/master/api/general.html#cross-origin-requests
+ *
+ *  By Stephen Ludgate https://www.youtube.com/channel/UCVEEuAouZ6ua4oetLjjHAuw
+ *******************************************************************/
+
+#include <OctoprintFarm.h> //This is where the magic happens... shazam!
+
+#include <WiFi.h>
+#include <WiFiClient.h>
+
+const char* ssid = "SSID";          // your network SSID (name)
+const char* password = "PASSWORD";  // your network password
+
+WiFiClient clients[4];              // one request in flight per client
+
+OctoprintFarm farm;
+
+unsigned long api_mtbs = 10000; //mean time between farm refreshes (10 seconds)
+unsigned long api_lasttime = 0; //last time a refresh was started
+
+void setup() {
+  Serial.begin(115200);
+  delay(10);
+
+  Serial.print("Connecting to ");
+  Serial.println(ssid);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println("");
+  Serial.println("WiFi connected");
+
+  for (int i = 0; i < 4; i++)
+    farm.addClient(clients[i]);
+
+  // Add each printer with its own IP (or hostname), port and API key
+  farm.addPrinter(IPAddress(192, 168, 123, 101), 80, "API_KEY_1");
+  farm.addPrinter(IPAddress(192, 168, 123, 102), 80, "API_KEY_2");
+  farm.addPrinter(IPAddress(192, 168, 123, 103), 80, "API_KEY_3");
+}
+
+void loop() {
+  if (!farm.poll() && (millis() - api_lasttime > api_mtbs || api_lasttime == 0)) {
+    // the previous refresh has finished, show it and start the next one
+    for (int i = 0; i < farm.printerCount(); i++) {
+      Serial.print("Printer ");
+      Serial.print(i);
+      Serial.print(":\t");
+      if (!farm.printers[i].online) {
+        Serial.println("offline");
+        continue;
+      }
+      Serial.print(farm.printers[i].printJob.printerState);
+      Serial.print("\t");
+      Serial.print(farm.printers[i].printJob.progressCompletion);
+      Serial.print(" %\tbed ");
+      Serial.print(farm.printers[i].printerStats.printerBedTempActual);
+      Serial.print("C\ttool ");
+      Serial.print(farm.printers[i].printerStats.printerTool0TempActual);
+      Serial.println("C");
+    }
+    farm.refresh();
+    api_lasttime = millis();
+  }
+}
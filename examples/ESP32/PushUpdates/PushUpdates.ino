@@ -0,0 +1,80 @@
+/*******************************************************************
+ *  Let OctoPrint push printer state, job progress and temperatures
+ *  over a WebSocket with OctoprintPushClient, instead of polling
+ *  the REST API. One long-lived connection replaces dozens of
+ *  requests a minute, and the callbacks only fire on a change.
+ *
+ *  You will need the IP or hostname of your OctoPrint server, a
+ *  port number (will be 80 unless you are reaching it from an
+ *  external source) and an API key from the OctoPrint
+ *  installation - http://docs.octoprint.org/en/master/api/general.html#authorization
+ *
+ *  By Stephen Ludgate https://www.youtube.com/channel/UCVEEuAouZ6ua4oetLjjHAuw
+ *******************************************************************/
+
+#include <OctoprintPushClient.h> //This is where the magic happens... shazam!
+
+#include <WiFi.h>
+#include <WiFiClient.h>
+
+const char* ssid = "SSID";          // your network SSID (name)
+const char* password = "PASSWORD";  // your network password
+
+WiFiClient client;
+
+// You only need to set one of the of follwowing:
+IPAddress ip(192, 168, 123, 123);                         // Your IP address of your OctoPrint server (inernal or external)
+// char* octoprint_host = "octoprint.example.com";  // Or your hostname. Comment out one or the other.
+
+const int octoprint_httpPort = 80;  //If you are connecting through a router this will work, but you need a random port forwarded to the OctoPrint server from your router. Enter that port here if you are external
+String octoprint_apikey = "API_KEY"; //See top of file or GIT Readme about getting API key
+
+// Use one of the following:
+OctoprintPushClient push(client, ip, octoprint_httpPort, octoprint_apikey);               //If using IP address
+// OctoprintPushClient push(client, octoprint_host, octoprint_httpPort, octoprint_apikey);//If using hostname. Comment out one or the other.
+
+void printerChanged(OctoprintPushClient *octoprint) {
+  Serial.print(octoprint->printerStats.printerState);
+  Serial.print("\tbed ");
+  Serial.print(octoprint->printerStats.printerBedTempActual);
+  Serial.print("C\ttool ");
+  Serial.print(octoprint->printerStats.printerTool0TempActual);
+  Serial.println("C");
+}
+
+void jobChanged(OctoprintPushClient *octoprint) {
+  Serial.print(octoprint->printJob.jobFileName);
+  Serial.print("\t");
+  Serial.print(octoprint->printJob.progressCompletion);
+  Serial.println(" %");
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(10);
+
+  Serial.print("Connecting to ");
+  Serial.println(ssid);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println("");
+  Serial.println("WiFi connected");
+
+  push.onPrinterStatistics(printerChanged);
+  push.onPrintJob(jobChanged);
+}
+
+void loop() {
+  if (!push.connected()) {
+    Serial.println("Connecting to the OctoPrint push API...");
+    if (push.connect())
+      push.setThrottle(2); //One update a second is plenty for a display
+    else
+      delay(5000);
+    return;
+  }
+  push.poll(); //Handles a waiting message, if there is one
+}
@@ -0,0 +1,94 @@
+/*******************************************************************
+ *  Use beginGetPrintJob() and poll() to fetch the current print job
+ *  without blocking loop(). The request runs in the background a
+ *  few bytes per poll() call, so LEDs, buttons or a display keep
+ *  running while OctoPrint answers. printJobReady() is called once
+ *  api.printJob has been filled in.
+ *
+ *  You will need the IP or hostname of your OctoPrint server, a
+ *  port number (will be 80 unless you are reaching it from an
+ *  external source) and an API key from the OctoPrint 
+ *  installation - http://docs.octoprint.org/en/master/api/general.html#authorization
+ *  You will also need to enable CORS - http://docs.octoprint.org/en/master/api/general.html#cross-origin-requests
+ *
+ *  By Stephen Ludgate https://www.youtube.com/channel/UCVEEuAouZ6ua4oetLjjHAuw 
+ *******************************************************************/
+
+#include <OctoPrintAPI.h> //This is where the magic happens... shazam!
+
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+
+const char* ssid = "SSID";          // your network SSID (name)
+const char* password = "PASSWORD";  // your network password
+WiFiClient client;
+
+// You only need to set one of the of follwowing:
+IPAddress ip(192, 168, 123, 123);                         // Your IP address of your OctoPrint server (inernal or external)
+// char* octoprint_host = "octoprint.example.com";  // Or your hostname. Comment out one or the other.
+
+const int octoprint_httpPort = 80;  //If you are connecting through a router this will work, but you need a random port forwarded to the OctoPrint server from your router. Enter that port here if you are external
+String octoprint_apikey = "API_KEY"; //See top of file or GIT Readme about getting API key
+
+// Use one of the following:
+//OctoprintApi api; //Be sure to call init in setup.
+OctoprintApi api(client, ip, octoprint_httpPort, octoprint_apikey);               //If using IP address
+// OctoprintApi api(client, octoprint_host, octoprint_httpPort, octoprint_apikey);//If using hostname. Comment out one or the other.
+
+unsigned long api_mtbs = 5000;  //mean time between api requests (5 seconds)
+unsigned long api_lasttime = 0; //last time api request has been done
+unsigned long loops = 0;        //proof that loop() keeps running while the request is in flight
+
+void printJobReady(OctoprintApi *octoprint, bool success) {
+  if (!success) {
+    Serial.print("Request failed, HTTP status: ");
+    Serial.println(octoprint->httpStatusCode);
+    return;
+  }
+  Serial.print(octoprint->printJob.printerState);
+  Serial.print("\t");
+  Serial.print(octoprint->printJob.progressCompletion);
+  Serial.print(" %\t(loop ran ");
+  Serial.print(loops);
+  Serial.println(" times since the last update)");
+  loops = 0;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(10);
+
+  // We start by connecting to a WiFi network
+  Serial.println();
+  Serial.print("Connecting to ");
+  Serial.println(ssid);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+
+  //if you get here you have connected to the WiFi
+  Serial.println("");
+  Serial.println("WiFi connected");
+  Serial.println("IP address: ");
+  Serial.println(WiFi.localIP());
+
+  api.setKeepAlive(true); //Keep the connection open, so the next request does not have to wait for connect()
+}
+
+void loop() {
+  loops++;
+  api.poll(); //Advances a running request, returns straight away
+
+  if (!api.requestInProgress() && (millis() - api_lasttime > api_mtbs || api_lasttime == 0)) {
+    if (WiFi.status() == WL_CONNECTED)
+      api.beginGetPrintJob(printJobReady);
+    api_lasttime = millis();
+  }
+
+  // ...animate LEDs, read buttons, update a display here...
+}
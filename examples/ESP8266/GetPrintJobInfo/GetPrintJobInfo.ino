@@ -183,14 +183,16 @@ void loop() {
         Serial.print(temp_percent);
         Serial.println("%");
 
-        //Print time left (if printing) in human readable time HH:MM:SS
-        int runHours= api.printJob.progressPrintTimeLeft/3600;
-        int secsRemaining=api.printJob.progressPrintTimeLeft%3600;
-        int runMinutes=secsRemaining/60;
-        int runSeconds=secsRemaining%60;
-        char buf[31];
-        sprintf(buf,"Print time left:\t%02d:%02d:%02d",runHours,runMinutes,runSeconds);
-        Serial.println(buf);
+        //Print time left (if printing) in human readable time HH:MM:SS, -1 until OctoPrint has an estimate
+        if (api.printJob.progressPrintTimeLeft >= 0) {
+          int runHours= api.printJob.progressPrintTimeLeft/3600;
+          int secsRemaining=api.printJob.progressPrintTimeLeft%3600;
+          int runMinutes=secsRemaining/60;
+          int runSeconds=secsRemaining%60;
+          char buf[31];
+          sprintf(buf,"Print time left:\t%02d:%02d:%02d",runHours,runMinutes,runSeconds);
+          Serial.println(buf);
+        }
         Serial.println("----------------------------------------"); 
         Serial.println();
       }
@@ -0,0 +1,89 @@
+/*******************************************************************
+ *  Keep a rolling temperature history with
+ *  OctoprintTemperatureHistory and draw it as a bar graph on the
+ *  serial monitor. The first update() loads the history OctoPrint
+ *  already has, every later one only fetches the samples taken
+ *  since, so a graph costs one small request per refresh.
+ *
+ *  You will need the IP or hostname of your OctoPrint server, a
+ *  port number (will be 80 unless you are reaching it from an
+ *  external source) and an API key from the OctoPrint 
+ *  installation - http://docs.octoprint.org/en/master/api/general.html#authorization
+ *  You will also need to enable CORS - http://docs.octoprint.org/en/master/api/general.html#cross-origin-requests
+ *
+ *  By Stephen Ludgate https://www.youtube.com/channel/UCVEEuAouZ6ua4oetLjjHAuw 
+ *******************************************************************/
+
+#include <OctoPrintAPI.h> //This is where the magic happens... shazam!
+#include <OctoprintTemperatureHistory.h>
+
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+
+const char* ssid = "SSID";          // your network SSID (name)
+const char* password = "PASSWORD";  // your network password
+WiFiClient client;
+
+// You only need to set one of the of follwowing:
+IPAddress ip(192, 168, 123, 123);                         // Your IP address of your OctoPrint server (inernal or external)
+// char* octoprint_host = "octoprint.example.com";  // Or your hostname. Comment out one or the other.
+
+const int octoprint_httpPort = 80;  //If you are connecting through a router this will work, but you need a random port forwarded to the OctoPrint server from your router. Enter that port here if you are external
+String octoprint_apikey = "API_KEY"; //See top of file or GIT Readme about getting API key
+
+// Use one of the following:
+//OctoprintApi api; //Be sure to call init in setup.
+OctoprintApi api(client, ip, octoprint_httpPort, octoprint_apikey);               //If using IP address
+// OctoprintApi api(client, octoprint_host, octoprint_httpPort, octoprint_apikey);//If using hostname. Comment out one or the other.
+
+OctoprintTemperatureHistory history(api);
+
+unsigned long api_mtbs = 10000; //mean time between api requests (10 seconds)
+unsigned long api_lasttime = 0; //last time api request has been done
+
+void drawBar(float actual, float target) {
+  for (int i = 0; i < 40; i++)
+    Serial.print(i < actual / 7.5 ? '#' : (i < target / 7.5 ? '.' : ' ')); // 40 columns for 0 - 300 C
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(10);
+
+  // We start by connecting to a WiFi network
+  Serial.println();
+  Serial.print("Connecting to ");
+  Serial.println(ssid);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+
+  //if you get here you have connected to the WiFi
+  Serial.println("");
+  Serial.println("WiFi connected");
+  Serial.println("IP address: ");
+  Serial.println(WiFi.localIP());
+}
+
+void loop() {
+  if (millis() - api_lasttime > api_mtbs || api_lasttime == 0) {
+    if (WiFi.status() == WL_CONNECTED && history.update()) {
+      Serial.println();
+      Serial.println("time        bed                                       tool0");
+      for (uint16_t i = 0; i < history.count(); i++) {
+        Serial.print(history.time(i));
+        Serial.print("  ");
+        drawBar(history.bedActual(i), history.bedTarget(i));
+        Serial.print("  ");
+        drawBar(history.toolActual(0, i), history.toolTarget(0, i));
+        Serial.println();
+      }
+    }
+    api_lasttime = millis();
+  }
+}
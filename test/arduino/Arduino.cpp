@@ -0,0 +1,149 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "Arduino.h"
+
+#include <atomic>
+#include <chrono>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+static std::atomic<unsigned long> skipped(0);
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count() +
+         skipped * 1000UL;
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void advanceMillis(unsigned long ms) { skipped += ms; }
+
+// Nothing on the PC is worth sleeping for, time just moves on.
+void delay(unsigned long ms) { advanceMillis(ms); }
+
+void yield() {}
+
+long random(long max) { return max > 0 ? rand() % max : 0; }
+
+String::String(double value, unsigned char decimals) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  _text = text;
+}
+
+std::string String::number(unsigned long value, unsigned char base) {
+  char text[40];
+  char *c = text + sizeof(text) - 1;
+  *c      = '\0';
+  do {
+    unsigned digit = value % base;
+    *--c           = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  return c;
+}
+
+std::string String::number(long value, unsigned char base) {
+  if (value < 0 && base == DEC)
+    return "-" + number((unsigned long)-value, base);
+  return number((unsigned long)value, base);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++) == 0)
+      break;
+    n++;
+  }
+  return n;
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0)
+      return c;
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+bool Stream::findUntil(const char *target, const char *terminator) {
+  size_t targetLength     = strlen(target);
+  size_t terminatorLength = terminator != NULL ? strlen(terminator) : 0;
+  size_t matched          = 0;
+  size_t terminated       = 0;
+  if (targetLength == 0)
+    return true;
+  for (;;) {
+    int c = timedRead();
+    if (c < 0)
+      return false;
+    matched = c == target[matched] ? matched + 1 : (c == target[0] ? 1 : 0);
+    if (matched == targetLength)
+      return true;
+    if (terminatorLength > 0) {
+      terminated = c == terminator[terminated] ? terminated + 1 : (c == terminator[0] ? 1 : 0);
+      if (terminated == terminatorLength)
+        return false;
+    }
+  }
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+String Stream::readString() {
+  String text;
+  int c;
+  while ((c = timedRead()) >= 0)
+    text += (char)c;
+  return text;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String text;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator)
+    text += (char)c;
+  return text;
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  size_t n = 0;
+  for (int i = 0; i < 4; i++) {
+    if (i > 0)
+      n += p.print('.');
+    n += p.print((unsigned int)_address[i]);
+  }
+  return n;
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+  return String(text);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (echo)
+    putchar(c);
+  return 1;
+}
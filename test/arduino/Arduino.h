@@ -0,0 +1,252 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Just enough of the Arduino core to build and run the library on a PC: String, Print, Stream, IPAddress, millis().
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)   (*(void *const *)(p))
+#define strlen_P   strlen
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define memcpy_P   memcpy
+#define snprintf_P snprintf
+
+#define DEC 10
+#define HEX 16
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long max);
+
+// Moves millis() forward without waiting, e.g. past a keep-alive timeout or a backoff.
+void advanceMillis(unsigned long ms);
+
+class String {
+ public:
+  String() {}
+  String(const char *text) : _text(text != NULL ? text : "") {}
+  String(const __FlashStringHelper *text) : _text((const char *)text) {}
+  String(char c) : _text(1, c) {}
+  String(int value, unsigned char base = DEC) : _text(number(value, base)) {}
+  String(unsigned int value, unsigned char base = DEC) : _text(number(value, base)) {}
+  String(long value, unsigned char base = DEC) : _text(number(value, base)) {}
+  String(unsigned long value, unsigned char base = DEC) : _text(number(value, base)) {}
+  String(double value, unsigned char decimals = 2);
+
+  String &operator=(const char *text) {
+    _text = text != NULL ? text : "";
+    return *this;
+  }
+  String &operator+=(const String &other) {
+    _text += other._text;
+    return *this;
+  }
+  String &operator+=(const char *text) {
+    if (text != NULL)
+      _text += text;
+    return *this;
+  }
+  String &operator+=(char c) {
+    _text += c;
+    return *this;
+  }
+  bool concat(const String &other) {
+    _text += other._text;
+    return true;
+  }
+  bool concat(const char *text) {
+    if (text != NULL)
+      _text += text;
+    return true;
+  }
+  bool concat(const char *text, unsigned int length) {
+    _text.append(text, length);
+    return true;
+  }
+  bool concat(char c) {
+    _text += c;
+    return true;
+  }
+  friend String operator+(const String &a, const String &b) {
+    String result(a);
+    result += b;
+    return result;
+  }
+  friend String operator+(const String &a, const char *b) {
+    String result(a);
+    result += b;
+    return result;
+  }
+  friend String operator+(const char *a, const String &b) {
+    String result(a);
+    result += b;
+    return result;
+  }
+  friend String operator+(const String &a, char b) {
+    String result(a);
+    result += b;
+    return result;
+  }
+  bool operator==(const String &other) const { return _text == other._text; }
+  bool operator==(const char *text) const { return _text == (text != NULL ? text : ""); }
+  bool operator!=(const String &other) const { return !(*this == other); }
+  bool operator!=(const char *text) const { return !(*this == text); }
+  char operator[](unsigned int index) const { return index < _text.size() ? _text[index] : 0; }
+
+  unsigned int length() const { return _text.size(); }
+  const char *c_str() const { return _text.c_str(); }
+  bool reserve(unsigned int size) {
+    _text.reserve(size);
+    return true;
+  }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+  bool startsWith(const String &prefix) const { return _text.compare(0, prefix._text.size(), prefix._text) == 0; }
+  bool endsWith(const String &suffix) const {
+    return _text.size() >= suffix._text.size() &&
+           _text.compare(_text.size() - suffix._text.size(), suffix._text.size(), suffix._text) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const { return found(_text.find(c, from)); }
+  int indexOf(const String &text, unsigned int from = 0) const { return found(_text.find(text._text, from)); }
+  int lastIndexOf(char c) const { return found(_text.rfind(c)); }
+  int lastIndexOf(const String &text) const { return found(_text.rfind(text._text)); }
+  String substring(unsigned int from) const { return substring(from, _text.size()); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > _text.size())
+      return String();
+    return String(_text.substr(from, to > from ? to - from : 0).c_str());
+  }
+  long toInt() const { return atol(_text.c_str()); }
+  float toFloat() const { return atof(_text.c_str()); }
+
+ private:
+  std::string _text;
+  static int found(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+  static std::string number(unsigned long value, unsigned char base);
+  static std::string number(long value, unsigned char base);
+  static std::string number(int value, unsigned char base) { return number((long)value, base); }
+  static std::string number(unsigned int value, unsigned char base) { return number((unsigned long)value, base); }
+};
+
+class Print;
+
+class Printable {
+ public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *text) { return text != NULL ? write((const uint8_t *)text, strlen(text)) : 0; }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char *text) { return write(text); }
+  size_t print(const String &text) { return write(text.c_str(), text.length()); }
+  size_t print(const __FlashStringHelper *text) { return write((const char *)text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+  size_t print(const Printable &printable) { return printable.printTo(*this); }
+  template <typename T>
+  size_t println(const T &value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T &value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+  size_t println() { return write("\r\n"); }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() { return _timeout; }
+  bool find(const char *target) { return findUntil(target, NULL); }
+  bool find(char *target) { return find((const char *)target); }
+  bool findUntil(const char *target, const char *terminator);
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  String readString();
+  String readStringUntil(char terminator);
+
+ protected:
+  unsigned long _timeout = 1000;
+  int timedRead();
+};
+
+class IPAddress : public Printable {
+ public:
+  IPAddress() { memset(_address, 0, sizeof(_address)); }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    _address[0] = a;
+    _address[1] = b;
+    _address[2] = c;
+    _address[3] = d;
+  }
+  uint8_t operator[](int index) const { return _address[index]; }
+  bool operator==(const IPAddress &other) const { return memcmp(_address, other._address, sizeof(_address)) == 0; }
+  bool operator!=(const IPAddress &other) const { return !(*this == other); }
+  size_t printTo(Print &p) const;
+  String toString() const;
+
+ private:
+  uint8_t _address[4];
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c);
+  using Print::write;
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  bool echo = false;  // print the library's debug output on stdout
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,1078 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Stand-in for the part of ArduinoJson 6 the library uses, so the tests build without fetching anything.
+// Point ARDUINOJSON_DIR at a real ArduinoJson to test against the real thing instead.
+// Documents are limited to their capacity the way ArduinoJson is on a 32 bit board: every object member or array
+// element takes a 16 byte slot and every copied string its length plus one, stored once per document. Filters,
+// NoMemory, implicit conversions, the | default operator and streams stopping right after the value all behave like
+// the original; what the library never touches (comments, nesting limits, MessagePack...) is left out.
+#ifndef ArduinoJson_h
+#define ArduinoJson_h
+
+#include <Arduino.h>
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define ARDUINOJSON_SLOT_SIZE 16
+
+namespace ArduinoJsonStandIn {
+
+struct Node {
+  enum Type { Null, Boolean, Integer, Float, String, Object, Array };
+  Type type       = Null;
+  bool boolean    = false;
+  long long integer = 0;
+  double real     = 0;
+  std::string text;
+  std::vector<std::pair<std::string, std::unique_ptr<Node> > > members;
+  std::vector<std::unique_ptr<Node> > items;
+
+  Node *member(const char *key) const {
+    if (type != Object || key == NULL)
+      return NULL;
+    for (size_t i = 0; i < members.size(); i++) {
+      if (members[i].first == key)
+        return members[i].second.get();
+    }
+    return NULL;
+  }
+  Node *item(size_t index) const { return type == Array && index < items.size() ? items[index].get() : NULL; }
+  void reset() {
+    type = Null;
+    text.clear();
+    members.clear();
+    items.clear();
+  }
+};
+
+class Pool {
+ public:
+  explicit Pool(size_t capacity) : _capacity(capacity) {}
+  bool slot() { return take(ARDUINOJSON_SLOT_SIZE); }
+  bool string(const std::string &text) {
+    if (_strings.count(text))
+      return true;
+    if (!take(text.size() + 1))
+      return false;
+    _strings.insert(text);
+    return true;
+  }
+  size_t used() const { return _used; }
+  size_t capacity() const { return _capacity; }
+  bool overflowed() const { return _overflowed; }
+  void clear() {
+    _used       = 0;
+    _overflowed = false;
+    _strings.clear();
+  }
+
+ private:
+  bool take(size_t size) {
+    if (_used + size > _capacity) {
+      _overflowed = true;
+      return false;
+    }
+    _used += size;
+    return true;
+  }
+  size_t _capacity;
+  size_t _used       = 0;
+  bool _overflowed   = false;
+  std::set<std::string> _strings;
+};
+
+template <typename T>
+struct isInteger {
+  static const bool value = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+};
+
+// what a variant converts to implicitly
+template <typename T>
+struct isReadable {
+  static const bool value = std::is_arithmetic<T>::value || std::is_same<T, const char *>::value ||
+                            std::is_same<T, ::String>::value;
+};
+
+}  // namespace ArduinoJsonStandIn
+
+class JsonObject;
+class JsonArray;
+class JsonDocument;
+
+class JsonString {
+ public:
+  explicit JsonString(const char *text) : _text(text) {}
+  const char *c_str() const { return _text; }
+  bool operator==(const char *text) const { return text != NULL && strcmp(_text, text) == 0; }
+
+ private:
+  const char *_text;
+};
+
+class JsonVariant {
+ public:
+  typedef ArduinoJsonStandIn::Node Node;
+
+  JsonVariant() {}
+  JsonVariant(Node *node, ArduinoJsonStandIn::Pool *pool) : _node(node), _pool(pool) {}
+
+  // ----- reading
+  bool isNull() const { return node() == NULL || node()->type == Node::Null; }
+  size_t size() const {
+    Node *n = node();
+    if (n == NULL)
+      return 0;
+    return n->type == Node::Object ? n->members.size() : n->type == Node::Array ? n->items.size() : 0;
+  }
+  bool containsKey(const char *key) const { return node() != NULL && node()->member(key) != NULL; }
+  bool containsKey(const String &key) const { return containsKey(key.c_str()); }
+
+  template <typename T>
+  T as() const;
+  template <typename T>
+  bool is() const;
+  template <typename T, typename = typename std::enable_if<ArduinoJsonStandIn::isReadable<T>::value>::type>
+  operator T() const {
+    return as<T>();
+  }
+  template <typename T>
+  typename std::enable_if<!std::is_pointer<T>::value, T>::type operator|(const T &fallback) const {
+    return is<T>() ? as<T>() : fallback;
+  }
+  const char *operator|(const char *fallback) const { return is<const char *>() ? as<const char *>() : fallback; }
+  bool operator==(const char *text) const { return is<const char *>() && text != NULL && node()->text == text; }
+  bool operator!=(const char *text) const { return !(*this == text); }
+
+  // ----- members and elements, created when assigned to
+  JsonVariant operator[](const char *key) const { return member(key, false); }
+  JsonVariant operator[](char *key) const { return member(key, true); }
+  JsonVariant operator[](const String &key) const { return member(key.c_str(), true); }
+  template <typename T>
+  typename std::enable_if<ArduinoJsonStandIn::isInteger<T>::value, JsonVariant>::type operator[](T index) const {
+    return element((size_t)index);
+  }
+
+  // ----- writing
+  JsonVariant &operator=(const JsonVariant &other) {
+    if (this != &other && other._pool == NULL && other._node == NULL && !other._create) {
+      _node   = NULL;
+      _pool   = NULL;
+      _create = nullptr;
+    } else if (this != &other) {
+      _node   = other._node;
+      _pool   = other._pool;
+      _create = other._create;
+    }
+    return *this;
+  }
+  JsonVariant(const JsonVariant &other) = default;
+  bool set(bool value) {
+    Node *n = prepare();
+    if (n == NULL)
+      return false;
+    n->type    = Node::Boolean;
+    n->boolean = value;
+    return true;
+  }
+  template <typename T>
+  typename std::enable_if<ArduinoJsonStandIn::isInteger<T>::value, bool>::type set(T value) {
+    Node *n = prepare();
+    if (n == NULL)
+      return false;
+    n->type    = Node::Integer;
+    n->integer = value;
+    return true;
+  }
+  template <typename T>
+  typename std::enable_if<std::is_floating_point<T>::value, bool>::type set(T value) {
+    Node *n = prepare();
+    if (n == NULL)
+      return false;
+    n->type = Node::Float;
+    n->real = value;
+    return true;
+  }
+  bool set(const char *value) { return setString(value, false); }
+  bool set(char *value) { return setString(value, true); }
+  bool set(const String &value) { return setString(value.c_str(), true); }
+  template <typename T>
+  JsonVariant operator=(const T &value) {
+    set(value);
+    return *this;
+  }
+  JsonVariant operator=(const char *value) {
+    set(value);
+    return *this;
+  }
+  JsonVariant operator=(char *value) {
+    set(value);
+    return *this;
+  }
+
+  JsonObject createNestedObject(const char *key) const;
+  JsonObject createNestedObject(char *key) const;
+  JsonArray createNestedArray(const char *key) const;
+  JsonArray createNestedArray(char *key) const;
+  JsonObject createNestedObject() const;
+  JsonArray createNestedArray() const;
+  template <typename T>
+  bool add(const T &value) const;
+
+  Node *node() const { return _node; }
+  ArduinoJsonStandIn::Pool *pool() const { return _pool; }
+
+ protected:
+  mutable Node *_node              = NULL;
+  ArduinoJsonStandIn::Pool *_pool = NULL;
+  std::function<Node *()> _create;
+
+  // Resolve (creating it if needed) and make sure it is null or of the given type.
+  // Reading never adds anything, writing through a missing member or element creates it first.
+  Node *resolve() const {
+    if (_node == NULL && _create)
+      _node = _create();
+    return _node;
+  }
+  Node *container(Node::Type type) const {
+    Node *n = resolve();
+    if (n == NULL)
+      return NULL;
+    if (n->type == Node::Null)
+      n->type = type;
+    return n->type == type ? n : NULL;
+  }
+  Node *prepare() {
+    Node *n = resolve();
+    if (n != NULL)
+      n->reset();
+    return n;
+  }
+  bool setString(const char *value, bool copy) {
+    if (value == NULL) {
+      Node *n = prepare();
+      return n != NULL;
+    }
+    if (copy && _pool != NULL && !_pool->string(value))
+      return false;
+    Node *n = prepare();
+    if (n == NULL)
+      return false;
+    n->type = Node::String;
+    n->text = value;
+    return true;
+  }
+  JsonVariant member(const char *key, bool copyKey) const {
+    JsonVariant child;
+    child._pool = _pool;
+    Node *n     = _node != NULL ? _node : NULL;
+    if (n != NULL)
+      child._node = n->member(key);
+    if (child._node == NULL && _pool != NULL && key != NULL) {
+      JsonVariant parent = *this;
+      std::string name   = key;
+      child._create      = [parent, name, copyKey]() -> Node * {
+        Node *object = parent.container(Node::Object);
+        if (object == NULL)
+          return NULL;
+        Node *found = object->member(name.c_str());
+        if (found != NULL)
+          return found;
+        if (!parent._pool->slot() || (copyKey && !parent._pool->string(name)))
+          return NULL;
+        object->members.push_back(std::make_pair(name, std::unique_ptr<Node>(new Node())));
+        return object->members.back().second.get();
+      };
+    }
+    return child;
+  }
+  JsonVariant element(size_t index) const {
+    JsonVariant child;
+    child._pool = _pool;
+    Node *n     = _node;
+    if (n != NULL)
+      child._node = n->item(index);
+    if (child._node == NULL && _pool != NULL) {
+      JsonVariant parent = *this;
+      child._create      = [parent, index]() -> Node * {
+        Node *array = parent.container(Node::Array);
+        if (array == NULL)
+          return NULL;
+        while (array->items.size() <= index) {
+          if (!parent._pool->slot())
+            return NULL;
+          array->items.push_back(std::unique_ptr<Node>(new Node()));
+        }
+        return array->items[index].get();
+      };
+    }
+    return child;
+  }
+};
+
+typedef JsonVariant JsonVariantConst;
+
+class JsonPair {
+ public:
+  JsonPair(const char *key, JsonVariant value) : _key(key), _value(value) {}
+  JsonString key() const { return _key; }
+  JsonVariant value() const { return _value; }
+
+ private:
+  JsonString _key;
+  JsonVariant _value;
+};
+
+class JsonObject : public JsonVariant {
+ public:
+  JsonObject() {}
+  JsonObject(Node *node, ArduinoJsonStandIn::Pool *pool) : JsonVariant(node, pool) {}
+  JsonObject(const JsonVariant &value)
+      : JsonVariant(value.node() != NULL && value.node()->type == Node::Object ? value.node() : NULL, value.pool()) {}
+
+  class iterator {
+   public:
+    iterator(Node *node, ArduinoJsonStandIn::Pool *pool, size_t index) : _node(node), _pool(pool), _index(index) {}
+    JsonPair operator*() const {
+      return JsonPair(_node->members[_index].first.c_str(), JsonVariant(_node->members[_index].second.get(), _pool));
+    }
+    iterator &operator++() {
+      _index++;
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return _index != other._index; }
+
+   private:
+    Node *_node;
+    ArduinoJsonStandIn::Pool *_pool;
+    size_t _index;
+  };
+  iterator begin() const { return iterator(object(), _pool, 0); }
+  iterator end() const { return iterator(object(), _pool, object() != NULL ? object()->members.size() : 0); }
+
+ private:
+  Node *object() const {
+    Node *n = node();
+    return n != NULL && n->type == Node::Object ? n : NULL;
+  }
+};
+
+typedef JsonObject JsonObjectConst;
+
+class JsonArray : public JsonVariant {
+ public:
+  JsonArray() {}
+  JsonArray(Node *node, ArduinoJsonStandIn::Pool *pool) : JsonVariant(node, pool) {}
+  JsonArray(const JsonVariant &value)
+      : JsonVariant(value.node() != NULL && value.node()->type == Node::Array ? value.node() : NULL, value.pool()) {}
+
+  class iterator {
+   public:
+    iterator(Node *node, ArduinoJsonStandIn::Pool *pool, size_t index) : _node(node), _pool(pool), _index(index) {}
+    JsonVariant operator*() const { return JsonVariant(_node->items[_index].get(), _pool); }
+    iterator &operator++() {
+      _index++;
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return _index != other._index; }
+
+   private:
+    Node *_node;
+    ArduinoJsonStandIn::Pool *_pool;
+    size_t _index;
+  };
+  iterator begin() const { return iterator(array(), _pool, 0); }
+  iterator end() const { return iterator(array(), _pool, array() != NULL ? array()->items.size() : 0); }
+
+ private:
+  Node *array() const {
+    Node *n = node();
+    return n != NULL && n->type == Node::Array ? n : NULL;
+  }
+};
+
+typedef JsonArray JsonArrayConst;
+
+// ----- conversions
+namespace ArduinoJsonStandIn {
+
+template <typename T, typename Enable = void>
+struct Converter;
+
+template <>
+struct Converter<bool> {
+  static bool is(const Node *n) { return n != NULL && n->type == Node::Boolean; }
+  static bool as(const Node *n) {
+    if (n == NULL)
+      return false;
+    switch (n->type) {
+      case Node::Boolean:
+        return n->boolean;
+      case Node::Integer:
+        return n->integer != 0;
+      case Node::Float:
+        return n->real != 0;
+      case Node::Null:
+        return false;
+      default:
+        return true;
+    }
+  }
+};
+
+template <typename T>
+struct Converter<T, typename std::enable_if<isInteger<T>::value>::type> {
+  static bool is(const Node *n) {
+    if (n == NULL || n->type != Node::Integer)
+      return false;
+    if (std::is_unsigned<T>::value)
+      return n->integer >= 0 && (unsigned long long)n->integer <= (unsigned long long)(T)-1;
+    return n->integer >= (long long)std::numeric_limits<T>::min() && n->integer <= (long long)std::numeric_limits<T>::max();
+  }
+  static T as(const Node *n) {
+    if (n == NULL)
+      return 0;
+    switch (n->type) {
+      case Node::Boolean:
+        return n->boolean;
+      case Node::Integer:
+        return (T)n->integer;
+      case Node::Float:
+        return (T)(long long)n->real;
+      case Node::String:
+        return (T)atoll(n->text.c_str());
+      default:
+        return 0;
+    }
+  }
+};
+
+template <typename T>
+struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static bool is(const Node *n) { return n != NULL && (n->type == Node::Integer || n->type == Node::Float); }
+  static T as(const Node *n) {
+    if (n == NULL)
+      return 0;
+    switch (n->type) {
+      case Node::Boolean:
+        return n->boolean;
+      case Node::Integer:
+        return (T)n->integer;
+      case Node::Float:
+        return (T)n->real;
+      case Node::String:
+        return (T)atof(n->text.c_str());
+      default:
+        return 0;
+    }
+  }
+};
+
+template <>
+struct Converter<const char *> {
+  static bool is(const Node *n) { return n != NULL && n->type == Node::String; }
+  static const char *as(const Node *n) { return is(n) ? n->text.c_str() : NULL; }
+};
+
+template <>
+struct Converter<String> {
+  static bool is(const Node *n) { return n != NULL && n->type == Node::String; }
+  static String as(const Node *n) { return is(n) ? String(n->text.c_str()) : String("null"); }
+};
+
+template <>
+struct Converter<JsonVariant> {
+  static bool is(const Node *) { return true; }
+};
+
+template <>
+struct Converter<JsonObject> {
+  static bool is(const Node *n) { return n != NULL && n->type == Node::Object; }
+};
+
+template <>
+struct Converter<JsonArray> {
+  static bool is(const Node *n) { return n != NULL && n->type == Node::Array; }
+};
+
+template <typename T>
+struct Access {
+  static T as(const JsonVariant &v) { return Converter<T>::as(v.node()); }
+};
+
+template <>
+struct Access<JsonVariant> {
+  static JsonVariant as(const JsonVariant &v) { return v; }
+};
+
+template <>
+struct Access<JsonObject> {
+  static JsonObject as(const JsonVariant &v) {
+    Node *n = v.node();
+    return JsonObject(n != NULL && n->type == Node::Object ? n : NULL, v.pool());
+  }
+};
+
+template <>
+struct Access<JsonArray> {
+  static JsonArray as(const JsonVariant &v) {
+    Node *n = v.node();
+    return JsonArray(n != NULL && n->type == Node::Array ? n : NULL, v.pool());
+  }
+};
+
+}  // namespace ArduinoJsonStandIn
+
+template <typename T>
+T JsonVariant::as() const {
+  return ArduinoJsonStandIn::Access<typename std::remove_cv<T>::type>::as(*this);
+}
+
+template <typename T>
+bool JsonVariant::is() const {
+  return ArduinoJsonStandIn::Converter<typename std::remove_cv<T>::type>::is(node());
+}
+
+inline JsonObject JsonVariant::createNestedObject(const char *key) const {
+  JsonVariant child = member(key, false);
+  return JsonObject(child.container(Node::Object), _pool);
+}
+
+inline JsonObject JsonVariant::createNestedObject(char *key) const {
+  JsonVariant child = member(key, true);
+  return JsonObject(child.container(Node::Object), _pool);
+}
+
+inline JsonArray JsonVariant::createNestedArray(const char *key) const {
+  JsonVariant child = member(key, false);
+  return JsonArray(child.container(Node::Array), _pool);
+}
+
+inline JsonArray JsonVariant::createNestedArray(char *key) const {
+  JsonVariant child = member(key, true);
+  return JsonArray(child.container(Node::Array), _pool);
+}
+
+inline JsonObject JsonVariant::createNestedObject() const {
+  JsonVariant child = element(size());
+  return JsonObject(child.container(Node::Object), _pool);
+}
+
+inline JsonArray JsonVariant::createNestedArray() const {
+  JsonVariant child = element(size());
+  return JsonArray(child.container(Node::Array), _pool);
+}
+
+template <typename T>
+bool JsonVariant::add(const T &value) const {
+  JsonVariant child = element(size());
+  return child.set(value);
+}
+
+class JsonDocument : public JsonVariant {
+ public:
+  explicit JsonDocument(size_t capacity) : _root(new Node()), _memory(capacity) {
+    _node = _root.get();
+    _pool = &_memory;
+  }
+  JsonDocument(const JsonDocument &) = delete;
+  JsonDocument &operator=(const JsonDocument &) = delete;
+
+  void clear() {
+    _root->reset();
+    _memory.clear();
+  }
+  size_t memoryUsage() const { return _memory.used(); }
+  size_t capacity() const { return _memory.capacity(); }
+  bool overflowed() const { return _memory.overflowed(); }
+  template <typename T>
+  JsonVariant operator=(const T &value) {
+    set(value);
+    return *this;
+  }
+
+ private:
+  std::unique_ptr<Node> _root;
+  ArduinoJsonStandIn::Pool _memory;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {
+ public:
+  StaticJsonDocument() : JsonDocument(N) {}
+};
+
+class DynamicJsonDocument : public JsonDocument {
+ public:
+  explicit DynamicJsonDocument(size_t capacity) : JsonDocument(capacity) {}
+};
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+  DeserializationError(Code code = Ok) : _code(code) {}
+  explicit operator bool() const { return _code != Ok; }
+  bool operator==(Code code) const { return _code == code; }
+  bool operator!=(Code code) const { return _code != code; }
+  Code code() const { return _code; }
+  const char *c_str() const {
+    static const char *const names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+    return names[_code];
+  }
+
+ private:
+  Code _code;
+};
+
+namespace DeserializationOption {
+
+class Filter {
+ public:
+  Filter() : _node(NULL), _all(true) {}
+  explicit Filter(const JsonVariant &filter) : _node(filter.node()), _all(false) {}
+  Filter(const ArduinoJsonStandIn::Node *node, bool all) : _node(node), _all(all) {}
+
+  bool allow() const { return _all || (_node != NULL && (_node->type == ArduinoJsonStandIn::Node::Object ||
+                                                         _node->type == ArduinoJsonStandIn::Node::Array ||
+                                                         (_node->type == ArduinoJsonStandIn::Node::Boolean && _node->boolean))); }
+  bool allowObject() const { return _all || (_node != NULL && _node->type == ArduinoJsonStandIn::Node::Object); }
+  bool allowArray() const { return _all || (_node != NULL && _node->type == ArduinoJsonStandIn::Node::Array); }
+  bool allowValue() const { return _all; }
+  Filter member(const std::string &key) const {
+    if (_all)
+      return *this;
+    if (_node == NULL || _node->type != ArduinoJsonStandIn::Node::Object)
+      return Filter(NULL, false);
+    const ArduinoJsonStandIn::Node *found = _node->member(key.c_str());
+    if (found == NULL)
+      found = _node->member("*");
+    return Filter(found, found != NULL && found->type == ArduinoJsonStandIn::Node::Boolean && found->boolean);
+  }
+  Filter element() const {
+    if (_all)
+      return *this;
+    const ArduinoJsonStandIn::Node *found = _node != NULL ? _node->item(0) : NULL;
+    return Filter(found, found != NULL && found->type == ArduinoJsonStandIn::Node::Boolean && found->boolean);
+  }
+
+ private:
+  const ArduinoJsonStandIn::Node *_node;
+  bool _all;
+};
+
+class NestingLimit {
+ public:
+  explicit NestingLimit(uint8_t) {}
+};
+
+}  // namespace DeserializationOption
+
+namespace ArduinoJsonStandIn {
+
+class Reader {
+ public:
+  virtual ~Reader() {}
+  virtual int read() = 0;
+};
+
+class StreamReader : public Reader {
+ public:
+  explicit StreamReader(Stream &stream) : _stream(stream) {}
+  int read() {
+    char c;
+    return _stream.readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+  }
+
+ private:
+  Stream &_stream;
+};
+
+class MemoryReader : public Reader {
+ public:
+  MemoryReader(const char *text, size_t length) : _text(text), _end(text + length) {}
+  int read() { return _text < _end && *_text ? (uint8_t)*_text++ : -1; }
+
+ private:
+  const char *_text;
+  const char *_end;
+};
+
+class Parser {
+ public:
+  Parser(Reader &reader, Pool &pool, bool copyStrings) : _reader(reader), _pool(pool), _copy(copyStrings) {}
+
+  DeserializationError parse(Node *root, const DeserializationOption::Filter &filter) {
+    skipSpace();
+    if (current() < 0)
+      return DeserializationError::EmptyInput;
+    return value(root, filter);
+  }
+
+ private:
+  Reader &_reader;
+  Pool &_pool;
+  bool _copy;
+  int _current  = -2;  // -2: nothing read ahead
+
+  int current() {
+    if (_current == -2)
+      _current = _reader.read();
+    return _current;
+  }
+  void move() { _current = -2; }
+  void skipSpace() {
+    while (current() == ' ' || current() == '\t' || current() == '\r' || current() == '\n')
+      move();
+  }
+  DeserializationError end() { return current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput; }
+
+  // node is NULL when the value is skipped
+  DeserializationError value(Node *node, const DeserializationOption::Filter &filter) {
+    skipSpace();
+    int c = current();
+    if (c == '{')
+      return object(filter.allowObject() ? node : NULL, filter);
+    if (c == '[')
+      return array(filter.allowArray() ? node : NULL, filter);
+    if (c == '"' || c == '\'') {
+      std::string text;
+      DeserializationError error = string(text);
+      if (error)
+        return error;
+      if (node != NULL && filter.allowValue()) {
+        if (_copy && !_pool.string(text))
+          return DeserializationError::NoMemory;
+        node->type = Node::String;
+        node->text = text;
+      }
+      return DeserializationError::Ok;
+    }
+    std::string token;
+    while ((c = current()) >= 0 && (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+      token += (char)c;
+      move();
+    }
+    if (token.empty())
+      return end();
+    if (node == NULL || !filter.allowValue())
+      return literal(token, NULL);
+    return literal(token, node);
+  }
+
+  DeserializationError literal(const std::string &token, Node *node) {
+    Node scratch;
+    if (node == NULL)
+      node = &scratch;
+    if (token == "true" || token == "false") {
+      node->type    = Node::Boolean;
+      node->boolean = token == "true";
+    } else if (token == "null")
+      node->type = Node::Null;
+    else {
+      char *stop;
+      if (token.find_first_of(".eE") == std::string::npos) {
+        node->integer = strtoll(token.c_str(), &stop, 10);
+        node->type    = Node::Integer;
+      } else {
+        node->real = strtod(token.c_str(), &stop);
+        node->type = Node::Float;
+      }
+      if (*stop != '\0')
+        return DeserializationError::InvalidInput;
+    }
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError string(std::string &text) {
+    int quote = current();
+    move();
+    for (;;) {
+      int c = current();
+      if (c < 0)
+        return DeserializationError::IncompleteInput;
+      move();
+      if (c == quote)
+        return DeserializationError::Ok;
+      if (c != '\\') {
+        text += (char)c;
+        continue;
+      }
+      c = current();
+      if (c < 0)
+        return DeserializationError::IncompleteInput;
+      move();
+      switch (c) {
+        case 'b':
+          text += '\b';
+          break;
+        case 'f':
+          text += '\f';
+          break;
+        case 'n':
+          text += '\n';
+          break;
+        case 'r':
+          text += '\r';
+          break;
+        case 't':
+          text += '\t';
+          break;
+        case 'u': {
+          unsigned code = 0;
+          for (int i = 0; i < 4; i++) {
+            c = current();
+            if (c < 0)
+              return DeserializationError::IncompleteInput;
+            if (!isxdigit(c))
+              return DeserializationError::InvalidInput;
+            move();
+            code = code * 16 + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+          }
+          if (code < 0x80)
+            text += (char)code;
+          else if (code < 0x800) {
+            text += (char)(0xc0 | (code >> 6));
+            text += (char)(0x80 | (code & 0x3f));
+          } else {
+            text += (char)(0xe0 | (code >> 12));
+            text += (char)(0x80 | ((code >> 6) & 0x3f));
+            text += (char)(0x80 | (code & 0x3f));
+          }
+          break;
+        }
+        default:
+          text += (char)c;
+      }
+    }
+  }
+
+  DeserializationError object(Node *node, const DeserializationOption::Filter &filter) {
+    move();  // '{'
+    if (node != NULL)
+      node->type = Node::Object;
+    skipSpace();
+    if (current() == '}') {
+      move();
+      return DeserializationError::Ok;
+    }
+    for (;;) {
+      skipSpace();
+      if (current() != '"' && current() != '\'')
+        return end();
+      std::string key;
+      DeserializationError error = string(key);
+      if (error)
+        return error;
+      skipSpace();
+      if (current() != ':')
+        return end();
+      move();
+
+      DeserializationOption::Filter memberFilter = filter.member(key);
+      Node *member                               = NULL;
+      if (node != NULL && memberFilter.allow()) {
+        member = node->member(key.c_str());
+        if (member == NULL) {
+          if (!_pool.slot() || (_copy && !_pool.string(key)))
+            return DeserializationError::NoMemory;
+          node->members.push_back(std::make_pair(key, std::unique_ptr<Node>(new Node())));
+          member = node->members.back().second.get();
+        }
+      }
+      error = value(member, memberFilter);
+      if (error)
+        return error;
+
+      skipSpace();
+      if (current() == '}') {
+        move();
+        return DeserializationError::Ok;
+      }
+      if (current() != ',')
+        return end();
+      move();
+    }
+  }
+
+  DeserializationError array(Node *node, const DeserializationOption::Filter &filter) {
+    move();  // '['
+    if (node != NULL)
+      node->type = Node::Array;
+    skipSpace();
+    if (current() == ']') {
+      move();
+      return DeserializationError::Ok;
+    }
+    DeserializationOption::Filter elementFilter = filter.element();
+    for (;;) {
+      Node *element = NULL;
+      if (node != NULL && elementFilter.allow()) {
+        if (!_pool.slot())
+          return DeserializationError::NoMemory;
+        node->items.push_back(std::unique_ptr<Node>(new Node()));
+        element = node->items.back().get();
+      }
+      DeserializationError error = value(element, elementFilter);
+      if (error)
+        return error;
+
+      skipSpace();
+      if (current() == ']') {
+        move();
+        return DeserializationError::Ok;
+      }
+      if (current() != ',')
+        return end();
+      move();
+    }
+  }
+};
+
+inline DeserializationError deserialize(JsonDocument &document, Reader &reader, bool copy,
+                                        const DeserializationOption::Filter &filter) {
+  document.clear();
+  Parser parser(reader, *document.pool(), copy);
+  return parser.parse(document.node(), filter);
+}
+
+inline size_t serialize(const Node *node, Print &out) {
+  if (node == NULL)
+    return out.print("null");
+  size_t n = 0;
+  char number[32];
+  switch (node->type) {
+    case Node::Null:
+      return out.print("null");
+    case Node::Boolean:
+      return out.print(node->boolean ? "true" : "false");
+    case Node::Integer:
+      snprintf(number, sizeof(number), "%lld", node->integer);
+      return out.print(number);
+    case Node::Float:
+      snprintf(number, sizeof(number), "%.9g", node->real);
+      return out.print(number);
+    case Node::String:
+      n += out.print('"');
+      for (size_t i = 0; i < node->text.size(); i++) {
+        char c = node->text[i];
+        if (c == '"' || c == '\\')
+          n += out.print('\\');
+        if (c == '\n') {
+          n += out.print("\\n");
+          continue;
+        }
+        n += out.print(c);
+      }
+      return n + out.print('"');
+    case Node::Object:
+      n += out.print('{');
+      for (size_t i = 0; i < node->members.size(); i++) {
+        if (i > 0)
+          n += out.print(',');
+        n += out.print('"');
+        n += out.print(node->members[i].first.c_str());
+        n += out.print("\":");
+        n += serialize(node->members[i].second.get(), out);
+      }
+      return n + out.print('}');
+    case Node::Array:
+      n += out.print('[');
+      for (size_t i = 0; i < node->items.size(); i++) {
+        if (i > 0)
+          n += out.print(',');
+        n += serialize(node->items[i].get(), out);
+      }
+      return n + out.print(']');
+  }
+  return n;
+}
+
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+}  // namespace ArduinoJsonStandIn
+
+inline DeserializationError deserializeJson(JsonDocument &document, Stream &input,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  ArduinoJsonStandIn::StreamReader reader(input);
+  return ArduinoJsonStandIn::deserialize(document, reader, true, filter);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, Stream &input, DeserializationOption::Filter filter,
+                                            DeserializationOption::NestingLimit) {
+  return deserializeJson(document, input, filter);
+}
+
+// char * input is parsed in place by ArduinoJson, the strings stay in the input and cost no memory
+inline DeserializationError deserializeJson(JsonDocument &document, char *input, size_t length,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  ArduinoJsonStandIn::MemoryReader reader(input, length);
+  return ArduinoJsonStandIn::deserialize(document, reader, false, filter);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, char *input,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  return deserializeJson(document, input, strlen(input), filter);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const char *input, size_t length,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  ArduinoJsonStandIn::MemoryReader reader(input, length);
+  return ArduinoJsonStandIn::deserialize(document, reader, true, filter);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const char *input,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  return deserializeJson(document, input, strlen(input), filter);
+}
+
+inline DeserializationError deserializeJson(JsonDocument &document, const String &input,
+                                            DeserializationOption::Filter filter = DeserializationOption::Filter()) {
+  return deserializeJson(document, input.c_str(), input.length(), filter);
+}
+
+inline size_t serializeJson(const JsonVariant &value, Print &out) { return ArduinoJsonStandIn::serialize(value.node(), out); }
+
+inline size_t serializeJson(const JsonVariant &value, String &out) {
+  ArduinoJsonStandIn::StringPrint text;
+  size_t n = serializeJson(value, text);
+  out      = text.text.c_str();
+  return n;
+}
+
+inline size_t serializeJson(const JsonVariant &value, char *out, size_t size) {
+  ArduinoJsonStandIn::StringPrint text;
+  serializeJson(value, text);
+  if (size == 0)
+    return 0;
+  size_t n = text.text.size() < size - 1 ? text.text.size() : size - 1;
+  memcpy(out, text.text.data(), n);
+  out[n] = '\0';
+  return n;
+}
+
+inline size_t measureJson(const JsonVariant &value) {
+  ArduinoJsonStandIn::StringPrint text;
+  return serializeJson(value, text);
+}
+
+#endif
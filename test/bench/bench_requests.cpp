@@ -0,0 +1,136 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Time, allocations and peak heap per call of the request path and every getter, against the mock server.
+// The legacy rows replay the String based header loop and extractHttpCode() of 1.1.6 for comparison.
+//
+//   bench_requests [iterations]
+#include <chrono>
+#include <functional>
+
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "alloc.h"
+
+static MockClient client;
+static OctoprintApi api;
+static volatile long sink;
+
+static void bench(const char *name, long iterations, const std::function<void()> &call) {
+  call();  // warm up: first connect, String capacities, the stand-in's first document
+  allocReset();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++)
+    call();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+  allocStats stats = allocRead();
+  printf("%-34s %10.0f %10.1f %12.0f %10zu\n", name, ns, (double)stats.allocations / iterations,
+         (double)stats.bytes / iterations, stats.peak);
+}
+
+// ----- 1.1.6: every header byte appended to a String, the status line re-parsed with substring()
+static int legacyExtractHttpCode(String statusCode, String) {
+  int firstSpace = statusCode.indexOf(" ");
+  int lastSpace  = statusCode.lastIndexOf(" ");
+  if (firstSpace > -1 && lastSpace > -1 && firstSpace != lastSpace) {
+    String statusCodeALL     = statusCode.substring(firstSpace + 1);
+    String statusCodeExtract = statusCode.substring(firstSpace + 1, lastSpace);
+    return statusCodeExtract.toInt();
+  }
+  return -1;
+}
+
+static int legacyHeaders(const std::string &response, int &bodySize) {
+  String statusCode       = "";
+  String headers          = "";
+  bool finishedStatusCode = false;
+  bool currentLineIsBlank = true;
+  int headerCount         = 0;
+  int headerLineStart     = 0;
+  bodySize                = -1;
+  for (char c : response) {
+    if (!finishedStatusCode) {
+      if (c == '\n')
+        finishedStatusCode = true;
+      else
+        statusCode = statusCode + c;
+    }
+    if (c == '\n') {
+      if (currentLineIsBlank)
+        break;
+      if (headers.substring(headerLineStart).startsWith("Content-Length: "))
+        bodySize = (headers.substring(headerLineStart + 16)).toInt();
+      headers = headers + c;
+      headerCount++;
+      headerLineStart = headerCount;
+    } else {
+      headers = headers + c;
+      headerCount++;
+    }
+    if (c == '\n')
+      currentLineIsBlank = true;
+    else if (c != '\r')
+      currentLineIsBlank = false;
+  }
+  return legacyExtractHttpCode(statusCode, "");
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 2000;
+  api.init(client, IPAddress(10, 0, 0, 2), 80, "0123456789ABCDEF");
+  api.setKeepAlive(true);
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  client.route("/api/printer/bed", httpResponse(200, recorded("printer_bed.json")));
+  client.route("/api/printer/sd", httpResponse(200, recorded("printer_sd.json")));
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  client.route("/api/files/local", httpResponse(200, recorded("files.json")));
+  client.route("/api/printer/command", httpResponse(204, ""));
+
+  std::string response = httpResponse(200, recorded("job.json"), "Server: nginx\r\nDate: Sat, 14 Oct 2023 13:12:25 GMT\r\n"
+                                                                 "Cache-Control: no-cache\r\nETag: \"9f3a\"\r\n");
+  std::string headers  = response.substr(0, response.find("\r\n\r\n") + 4);
+
+  printf("%-34s %10s %10s %12s %10s\n", "", "ns/call", "allocs", "bytes", "peak heap");
+  bench("headers, legacy String loop", iterations, [&] {
+    int bodySize;
+    sink = legacyHeaders(headers, bodySize) + bodySize;
+  });
+  bench("headers, OctoprintResponseParser", iterations, [&] {
+    OctoprintResponseParser parser;
+    parser.reset();
+    for (char c : headers)
+      parser.parse(c);
+    sink = parser.statusCode + parser.contentLength;
+  });
+  bench("sendGetToOctoprint", iterations, [] { sink = api.sendGetToOctoprint("/api/job").length(); });
+  bench("getOctoprintVersion", iterations, [] { sink = api.getOctoprintVersion(); });
+  bench("getPrinterStatistics", iterations, [] { sink = api.getPrinterStatistics(); });
+  bench("getPrintJob", iterations, [] { sink = api.getPrintJob(); });
+  bench("octoPrintGetPrinterBed", iterations, [] { sink = api.octoPrintGetPrinterBed(); });
+  bench("octoPrintGetPrinterSD", iterations, [] { sink = api.octoPrintGetPrinterSD(); });
+  bench("refreshAll", iterations, [] { sink = api.refreshAll(); });
+  printerSnapshot printer;
+  jobSnapshot job;
+  bench("getPrinterSnapshot", iterations, [&] { sink = api.getPrinterSnapshot(printer); });
+  bench("getJobSnapshot", iterations, [&] { sink = api.getJobSnapshot(job); });
+  bench("octoPrintListFiles", iterations, [] {
+    sink = api.octoPrintListFiles([](OctoprintApi *, const octoprintFile &) { return true; });
+  });
+  bench("octoPrintPrinterCommand", iterations, [] { sink = api.octoPrintPrinterCommand((char *)"M117 Hello"); });
+  bench("beginGetPrintJob + poll", iterations, [] {
+    api.beginGetPrintJob();
+    while (api.poll())
+      ;
+    sink = api.requestSucceeded();
+  });
+  // Allocations of the getters include what the JSON library does; with the stand-in that is far more than
+  // ArduinoJson's fixed pool, build with -DARDUINOJSON_DIR=... to see what a board would do.
+  return 0;
+}
@@ -0,0 +1,256 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "MockClient.h"
+
+#include "alloc.h"
+
+#include <stdio.h>
+
+static std::string lower(std::string text) {
+  for (char &c : text)
+    c = tolower(c);
+  return text;
+}
+
+std::string mockRequest::header(const char *name) const {
+  std::string wanted = lower(name) + ":";
+  size_t start       = 0;
+  while (start < headers.size()) {
+    size_t end       = headers.find("\r\n", start);
+    std::string line = headers.substr(start, end - start);
+    if (lower(line.substr(0, wanted.size())) == wanted) {
+      size_t value = line.find_first_not_of(' ', wanted.size());
+      return value == std::string::npos ? "" : line.substr(value);
+    }
+    if (end == std::string::npos)
+      break;
+    start = end + 2;
+  }
+  return "";
+}
+
+void MockClient::route(const char *target, const std::string &response) { _routes[target] = response; }
+
+void MockClient::queue(const std::string &response) { _queue.push_back(response); }
+
+void MockClient::dropConnection() {
+  _open = false;
+  _output.clear();
+  _position = _packet = 0;
+}
+
+void MockClient::push(const std::string &bytes) {
+  if (_position == _output.size()) {
+    _output.clear();
+    _position = 0;
+  }
+  _output += bytes;
+  _readyAt = millis();
+}
+
+void MockClient::reset() {
+  dropConnection();
+  _input.clear();
+  _queue.clear();
+  _routes.clear();
+  handler = nullptr;
+  requests.clear();
+  upgraded.clear();
+  connects = writes = stops = 0;
+  fragment = writeLimit = 0;
+  failConnects = zeroWrites = 0;
+  silent       = false;
+  connectDelay = responseDelay = 0;
+}
+
+bool MockClient::open() {
+  allocIgnore server;
+  advanceMillis(connectDelay);
+  connects++;
+  if (failConnects > 0) {
+    failConnects--;
+    return false;
+  }
+  dropConnection();
+  _input.clear();
+  _open       = true;
+  _closeAfter = false;
+  _upgraded   = false;
+  return true;
+}
+
+int MockClient::connect(IPAddress ip, uint16_t) {
+  lastIp = ip;
+  lastHost.clear();
+  return open();
+}
+
+int MockClient::connect(const char *host, uint16_t) {
+  lastHost = host;
+  return open();
+}
+
+size_t MockClient::write(uint8_t c) { return write(&c, 1); }
+
+size_t MockClient::write(const uint8_t *buffer, size_t size) {
+  allocIgnore server;
+  writes++;
+  if (!_open)
+    return 0;
+  if (zeroWrites > 0) {
+    zeroWrites--;
+    advanceMillis(1);  // the send buffer is full, time passes while it drains
+    return 0;
+  }
+  if (writeLimit > 0 && size > writeLimit)
+    size = writeLimit;
+  _input.append((const char *)buffer, size);
+  answer();
+  return size;
+}
+
+// Answers every complete request in _input.
+void MockClient::answer() {
+  for (;;) {
+    if (_upgraded) {
+      upgraded += _input;
+      _input.clear();
+      return;
+    }
+    size_t end = _input.find("\r\n\r\n");
+    if (end == std::string::npos)
+      return;
+    mockRequest request;
+    size_t lineEnd = _input.find("\r\n");
+    std::string line = _input.substr(0, lineEnd);
+    size_t space     = line.find(' ');
+    request.method   = line.substr(0, space);
+    request.target   = line.substr(space + 1, line.rfind(' ') - space - 1);
+    request.headers  = _input.substr(lineEnd + 2, end - lineEnd);
+    size_t length    = atol(request.header("Content-Length").c_str());
+    if (_input.size() < end + 4 + length)
+      return;  // the payload is still on its way
+    request.body = _input.substr(end + 4, length);
+    _input.erase(0, end + 4 + length);
+    requests.push_back(request);
+    if (silent)
+      continue;
+
+    std::string response;
+    if (!_queue.empty()) {
+      response = _queue.front();
+      _queue.pop_front();
+    } else if (handler) {
+      response = handler(request);
+    } else {
+      std::map<std::string, std::string>::iterator found = _routes.find(request.target);
+      if (found == _routes.end())
+        found = _routes.find(request.target.substr(0, request.target.find('?')));
+      response = found != _routes.end() ? found->second : httpResponse(404, "{\"error\": \"Not found\"}");
+    }
+    if (_position == _output.size()) {
+      _output.clear();
+      _position = 0;
+    }
+    _output += response;
+    _readyAt = millis() + responseDelay;
+    _closeAfter |= lower(request.header("Connection")) == "close" || lower(response).find("\r\nconnection: close") != std::string::npos;
+    _upgraded = response.compare(0, 13, "HTTP/1.1 101 ") == 0;
+  }
+}
+
+int MockClient::available() {
+  if (_position == _output.size() || (long)(millis() - _readyAt) < 0) {
+    if (_position == _output.size() && _closeAfter)
+      _open = false;
+    advanceMillis(1);  // nothing there yet, time passes while the caller waits
+    return 0;
+  }
+  if (_packet == 0) {
+    if (_gap) {
+      _gap = false;
+      advanceMillis(1);
+      return 0;
+    }
+    size_t left = _output.size() - _position;
+    _packet     = fragment > 0 && fragment < left ? fragment : left;
+  }
+  return _packet;
+}
+
+int MockClient::read() {
+  if (available() == 0)
+    return -1;
+  uint8_t c = _output[_position++];
+  if (--_packet == 0)
+    _gap = fragment > 0;
+  return c;
+}
+
+int MockClient::read(uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && available() > 0)
+    buffer[n++] = read();
+  return n > 0 ? (int)n : -1;
+}
+
+int MockClient::peek() { return available() > 0 ? (uint8_t)_output[_position] : -1; }
+
+void MockClient::stop() {
+  allocIgnore server;
+  if (_open || _position < _output.size())
+    stops++;
+  dropConnection();
+  _input.clear();
+}
+
+uint8_t MockClient::connected() {
+  if (_position < _output.size())
+    return 1;  // unread data keeps a client connected, like WiFiClient
+  if (_closeAfter)
+    _open = false;
+  return _open;
+}
+
+std::string httpResponse(int status, const std::string &body, const std::string &headers, size_t chunkSize) {
+  const char *reason = status == 200 ? "OK" : status == 204 ? "No Content" : status == 304 ? "Not Modified" : status == 404 ? "Not Found" : "Status";
+  char line[64];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", status, reason);
+  std::string response = line;
+  response += "Content-Type: application/json\r\n";
+  response += headers;
+  if (chunkSize == 0) {
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    return response;
+  }
+  response += "Transfer-Encoding: chunked\r\n\r\n";
+  for (size_t i = 0; i < body.size(); i += chunkSize) {
+    std::string piece = body.substr(i, chunkSize);
+    snprintf(line, sizeof(line), "%zx\r\n", piece.size());
+    response += line + piece + "\r\n";
+  }
+  return response + "0\r\n\r\n";
+}
+
+std::string recorded(const char *name) {
+  std::string path = std::string(OPAPI_TEST_RESPONSES) + "/" + name;
+  FILE *file       = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    fprintf(stderr, "missing recorded response %s\n", path.c_str());
+    exit(1);
+  }
+  std::string text;
+  char buffer[512];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    text.append(buffer, n);
+  fclose(file);
+  return text;
+}
@@ -0,0 +1,95 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Scripted stand-in for OctoPrint behind a Client. Requests written to it are parsed and answered from queued or
+// routed responses; how the answer arrives (in fragments, late) and how the socket behaves (refused
+// connects, short writes, closing) is up to the test.
+#ifndef OctoprintMockClient_h
+#define OctoprintMockClient_h
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct mockRequest {
+  std::string method;
+  std::string target;  // path and query
+  std::string headers;
+  std::string body;
+  std::string header(const char *name) const;  // value of a header, empty when missing
+};
+
+class MockClient : public Client {
+ public:
+  // ----- the server side
+  void route(const char *target, const std::string &response);  // answer for a target, or its path without the query
+  void queue(const std::string &response);                      // answered once, in order, before any route
+  std::function<std::string(const mockRequest &)> handler;      // asked after the queue, before the routes
+  void dropConnection();                                        // the server closes the socket, e.g. while idle
+  void push(const std::string &bytes);                          // the server sends unasked, e.g. on a WebSocket
+  void reset();                                                 // forget routes, queue, requests and counters
+
+  size_t fragment             = 0;      // bytes per packet, 0 delivers a whole response at once
+  int failConnects            = 0;      // the next connects are refused
+  size_t writeLimit           = 0;      // most bytes one write() accepts, 0 for no limit
+  int zeroWrites              = 0;      // the next writes accept nothing
+  bool silent                 = false;  // connects, but never answers
+  unsigned long connectDelay  = 0;      // ms a connect takes
+  unsigned long responseDelay = 0;      // ms between a request and the first byte of its response
+
+  std::vector<mockRequest> requests;
+  std::string upgraded;  // bytes written after a 101 answer switched the connection away from HTTP
+  unsigned long connects = 0;
+  unsigned long writes   = 0;
+  unsigned long stops    = 0;
+  std::string lastHost;
+  IPAddress lastIp;
+
+  // ----- Client
+  int connect(IPAddress ip, uint16_t port);
+  int connect(const char *host, uint16_t port);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buffer, size_t size);
+  int peek();
+  void flush() {}
+  void stop();
+  uint8_t connected();
+  operator bool() { return connected(); }
+  using Print::write;
+
+ private:
+  bool _open             = false;
+  std::string _input;               // request bytes not answered yet
+  std::string _output;              // response bytes on their way to the client
+  size_t _position       = 0;       // next byte of _output the client reads
+  size_t _packet         = 0;       // bytes left of the packet that has arrived
+  bool _gap              = false;   // a packet was just used up, the next one is not there yet
+  unsigned long _readyAt = 0;       // millis() the response starts arriving
+  bool _closeAfter       = false;   // the server hangs up once the response has been read
+  bool _upgraded         = false;   // a 101 answer was sent, nothing after it is HTTP
+  std::deque<std::string> _queue;
+  std::map<std::string, std::string> _routes;
+  bool open();
+  void answer();
+};
+
+// A complete HTTP/1.1 response with a JSON body, framed with Content-Length or chunked in pieces of chunkSize.
+std::string httpResponse(int status, const std::string &body, const std::string &headers = "", size_t chunkSize = 0);
+// Contents of a recorded OctoPrint response in test/responses.
+std::string recorded(const char *name);
+
+#endif
@@ -0,0 +1,75 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "alloc.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// Every block carries its size in front of it, so delete knows how much is freed, 0 when it was not counted.
+static const size_t header = 16;
+static thread_local int ignoring = 0;
+
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> bytes(0);
+static std::atomic<long> live(0);
+static std::atomic<long> peak(0);
+static long base = 0;
+
+void allocReset() {
+  allocations = 0;
+  bytes       = 0;
+  base        = live;
+  peak        = base;
+}
+
+allocStats allocRead() {
+  allocStats stats;
+  stats.allocations = allocations;
+  stats.bytes       = bytes;
+  stats.live        = live > base ? live - base : 0;
+  stats.peak        = peak - base;
+  return stats;
+}
+
+static void *allocate(size_t size) {
+  char *block = (char *)malloc(size + header);
+  if (block == NULL)
+    throw std::bad_alloc();
+  *(size_t *)block = ignoring ? 0 : size;
+  if (ignoring)
+    return block + header;
+  allocations++;
+  bytes += size;
+  long now  = live += size;
+  long high = peak;
+  while (now > high && !peak.compare_exchange_weak(high, now))
+    ;
+  return block + header;
+}
+
+static void release(void *pointer) {
+  if (pointer == NULL)
+    return;
+  char *block = (char *)pointer - header;
+  live -= *(size_t *)block;
+  free(block);
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *pointer) noexcept { release(pointer); }
+void operator delete[](void *pointer) noexcept { release(pointer); }
+void operator delete(void *pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { release(pointer); }
+
+allocIgnore::allocIgnore() { ignoring++; }
+
+allocIgnore::~allocIgnore() { ignoring--; }
@@ -0,0 +1,33 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Counts what goes through operator new, so a test or benchmark can tell how much a call allocates.
+#ifndef OctoprintAlloc_h
+#define OctoprintAlloc_h
+
+#include <stddef.h>
+
+struct allocStats {
+  size_t allocations;  // calls to new
+  size_t bytes;        // bytes asked for
+  size_t live;         // bytes allocated and not freed yet
+  size_t peak;         // highest live seen
+};
+
+// Starts counting from zero, peak is measured relative to what was live at this point.
+void allocReset();
+allocStats allocRead();
+
+// Allocations made while one of these lives on the current thread are not counted, e.g. the mock server's own.
+struct allocIgnore {
+  allocIgnore();
+  ~allocIgnore();
+};
+
+#endif
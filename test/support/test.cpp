@@ -0,0 +1,53 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+#include "test.h"
+
+#include <vector>
+
+struct registeredTest {
+  const char *name;
+  testFunction function;
+};
+
+static std::vector<registeredTest> &tests() {
+  static std::vector<registeredTest> all;
+  return all;
+}
+
+static const char *current = "";
+static int failures        = 0;
+
+testCase::testCase(const char *name, testFunction function) { tests().push_back({name, function}); }
+
+void testFailed(const char *file, int line, const std::string &message) {
+  printf("  %s:%d: %s failed: %s\n", file, line, current, message.c_str());
+  failures++;
+}
+
+const char *testName() { return current; }
+
+// Runs every test, or only those named on the command line.
+int main(int argc, char **argv) {
+  int run = 0;
+  for (const registeredTest &test : tests()) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; i++)
+      selected |= strcmp(argv[i], test.name) == 0;
+    if (!selected)
+      continue;
+    current    = test.name;
+    int before = failures;
+    test.function();
+    printf("%s %s\n", failures == before ? "ok  " : "FAIL", test.name);
+    run++;
+  }
+  printf("%d tests, %d failures\n", run, failures);
+  return failures == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Minimal test runner: TEST() registers a function, CHECK() records a failure and carries on, main() runs them all.
+#ifndef OctoprintTest_h
+#define OctoprintTest_h
+
+#include <Arduino.h>
+
+#include <functional>
+#include <string>
+
+typedef void (*testFunction)();
+
+struct testCase {
+  testCase(const char *name, testFunction function);
+};
+
+void testFailed(const char *file, int line, const std::string &message);
+const char *testName();
+
+#define TEST(name)                                  \
+  static void name();                               \
+  static testCase name##_registration(#name, name); \
+  static void name()
+
+#define CHECK(condition)                                    \
+  do {                                                      \
+    if (!(condition))                                       \
+      testFailed(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                       \
+  do {                                                                                                   \
+    auto _actual   = (actual);                                                                           \
+    auto _expected = (expected);                                                                         \
+    if (!(_actual == _expected))                                                                         \
+      testFailed(__FILE__, __LINE__, std::string("CHECK_EQ(" #actual ", " #expected ") got ") +        \
+                                         testString(_actual) + ", expected " + testString(_expected)); \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                             \
+  do {                                                                                                      \
+    double _actual = (actual);                                                                              \
+    if (fabs(_actual - (expected)) > (tolerance))                                                           \
+      testFailed(__FILE__, __LINE__, std::string("CHECK_NEAR(" #actual ", " #expected ") got ") +         \
+                                         testString(_actual));                                              \
+  } while (0)
+
+inline std::string testString(const char *value) { return value != NULL ? std::string("\"") + value + "\"" : "NULL"; }
+inline std::string testString(const std::string &value) { return "\"" + value + "\""; }
+inline std::string testString(const String &value) { return testString(value.c_str()); }
+inline std::string testString(bool value) { return value ? "true" : "false"; }
+template <typename T>
+std::string testString(const T &value) {
+  return std::to_string(value);
+}
+
+#endif
@@ -0,0 +1,187 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// The non-blocking API against a server that delivers its answers a few bytes at a time.
+#include "MockClient.h"
+#include "alloc.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+static int callbacks;
+static bool lastOutcome;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(192, 168, 1, 20), 80, "key");
+  instance.setKeepAlive(true);
+  callbacks = 0;
+  return instance;
+}
+
+static void done(OctoprintApi *, bool success) {
+  callbacks++;
+  lastOutcome = success;
+}
+
+// Polls until the request is over, returns the number of poll() calls it took.
+static int finish(OctoprintApi &octoprint) {
+  int polls = 0;
+  while (octoprint.poll() && polls < 100000)
+    polls++;
+  return polls + 1;
+}
+
+TEST(fragmentedPrintJob) {
+  const size_t fragments[] = {1, 2, 3, 7, 13, 64, 500, 0};
+  for (size_t fragment : fragments) {
+    OctoprintApi &octoprint = api();
+    client.fragment         = fragment;
+    client.route("/api/job", httpResponse(200, recorded("job.json")));
+    octoprint.printJob.progressPrintTimeLeft = 0;
+    CHECK(octoprint.beginGetPrintJob(done));
+    CHECK(octoprint.requestInProgress());
+    int polls = finish(octoprint);
+    CHECK(!octoprint.requestInProgress());
+    CHECK_EQ(callbacks, 1);
+    CHECK(lastOutcome);
+    CHECK(octoprint.requestSucceeded());
+    CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+    CHECK_EQ(octoprint.printJob.jobFilePath, String("parts/benchy.gcode"));
+    if (fragment == 1)
+      CHECK(polls > (int)recorded("job.json").size());  // one byte per poll at most
+  }
+}
+
+TEST(fragmentedChunkedPrinterStatistics) {
+  const size_t fragments[] = {1, 5, 11, 0};
+  for (size_t fragment : fragments) {
+    OctoprintApi &octoprint = api();
+    client.fragment         = fragment;
+    client.route("/api/printer", httpResponse(200, recorded("printer.json"), "", 61));
+    CHECK(octoprint.beginGetPrinterStatistics());
+    finish(octoprint);
+    CHECK(octoprint.requestSucceeded());
+    CHECK(octoprint.requestChanged());
+    CHECK_EQ(octoprint.printerStats.printerToolCount, (uint8_t)3);
+    CHECK_NEAR(octoprint.printerStats.printerBedTempActual, 59.8, 0.01);
+  }
+}
+
+// Every poll() handles at most OPAPI_POLL_BUDGET bytes, whatever is waiting on the socket.
+TEST(pollWorkIsBounded) {
+  OctoprintApi &octoprint = api();
+  std::string response    = httpResponse(200, recorded("job.json"));
+  client.route("/api/job", response);
+  CHECK(octoprint.beginGetPrintJob());
+  int polls = finish(octoprint);
+  CHECK(polls >= (int)(response.size() / OPAPI_POLL_BUDGET));
+  CHECK(octoprint.requestSucceeded());
+}
+
+TEST(unchangedAnswer) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json"), "ETag: \"7\"\r\n"));
+  CHECK(octoprint.beginGetPrintJob());
+  finish(octoprint);
+  CHECK(octoprint.requestChanged());
+  CHECK(octoprint.beginGetPrintJob());
+  finish(octoprint);
+  CHECK(octoprint.requestSucceeded());
+  CHECK(!octoprint.requestChanged());
+  CHECK_EQ(client.connects, 1UL);
+}
+
+TEST(oneRequestAtATime) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  CHECK(octoprint.beginGetPrintJob());
+  CHECK(!octoprint.beginGetPrinterStatistics());
+  CHECK(!octoprint.getOctoprintVersion());  // the blocking calls wait their turn too
+  finish(octoprint);
+  CHECK(octoprint.requestSucceeded());
+}
+
+TEST(staleConnectionIsRetried) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  CHECK(octoprint.beginGetPrintJob());
+  finish(octoprint);
+  client.dropConnection();
+  CHECK(octoprint.beginGetPrintJob(done));
+  finish(octoprint);
+  CHECK(lastOutcome);
+  CHECK_EQ(client.connects, 2UL);
+}
+
+TEST(postIsNotSentTwice) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  CHECK(octoprint.beginGetPrintJob());
+  finish(octoprint);
+  client.handler = [](const mockRequest &) {
+    client.dropConnection();  // took the command, hung up before answering
+    return std::string();
+  };
+  CHECK(octoprint.beginSendPostToOctoPrint("/api/printer/command", "{\"command\": \"G28\"}", done));
+  finish(octoprint);
+  CHECK(!lastOutcome);
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(client.connects, 1UL);
+}
+
+TEST(timeout) {
+  OctoprintApi &octoprint = api();
+  client.silent = true;
+  CHECK(octoprint.beginGetPrintJob(done));
+  finish(octoprint);
+  CHECK_EQ(callbacks, 1);
+  CHECK(!lastOutcome);
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+}
+
+TEST(postWithPayload) {
+  OctoprintApi &octoprint = api();
+  client.fragment         = 3;
+  client.route("/api/printer/command", httpResponse(204, ""));
+  CHECK(octoprint.beginSendPostToOctoPrint("/api/printer/command", "{\"command\": \"G28\"}", done));
+  finish(octoprint);
+  CHECK(lastOutcome);
+  CHECK_EQ(octoprint.httpStatusCode, 204);
+  CHECK_EQ(client.requests[0].body, std::string("{\"command\": \"G28\"}"));
+}
+
+// The body buffer is not part of every OctoprintApi, the first begin...() (or blocking job/printer getter) allocates
+// it and later ones reuse it.
+TEST(bufferIsAllocatedOnFirstUse) {
+  CHECK(sizeof(OctoprintApi) < OPAPI_ASYNC_BUFFER_SIZE);
+  OctoprintApi octoprint(client, IPAddress(192, 168, 1, 20), 80, "key");
+  client.reset();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  CHECK(octoprint.getOctoprintVersion());
+
+  allocReset();
+  CHECK(octoprint.beginGetPrintJob());
+  CHECK(allocRead().bytes >= OPAPI_ASYNC_BUFFER_SIZE);
+  finish(octoprint);
+  CHECK(octoprint.requestSucceeded());
+
+  allocReset();
+  CHECK(octoprint.beginGetPrintJob());
+  finish(octoprint);
+  CHECK(octoprint.requestSucceeded());
+  CHECK(allocRead().bytes < OPAPI_ASYNC_BUFFER_SIZE);
+
+  allocReset();
+  CHECK(octoprint.getPrintJob());
+  CHECK(allocRead().live < OPAPI_ASYNC_BUFFER_SIZE);  // the String fields come and go, no second buffer stays
+}
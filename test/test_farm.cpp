@@ -0,0 +1,118 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintFarm: several printers refreshed over a smaller pool of clients.
+#include "MockClient.h"
+#include "OctoprintFarm.h"
+#include "test.h"
+
+static MockClient clients[3];
+
+// Printer n answers at 10.0.0.n with a job named after it; the printers in silentOnes never answer.
+static std::vector<int> silentOnes;
+
+static void serve(MockClient &client) {
+  client.reset();
+  MockClient *self = &client;
+  client.handler   = [self](const mockRequest &request) {
+    int printer = self->lastIp[3];
+    for (int silent : silentOnes)
+      if (silent == printer)
+        return std::string();
+    if (request.target.compare(0, 12, "/api/printer") == 0)
+      return httpResponse(200, recorded("printer.json"));
+    return httpResponse(200, "{\"job\": {\"file\": {\"name\": \"printer" + std::to_string(printer) +
+                                 ".gcode\"}}, \"progress\": {\"completion\": 10.0}, \"state\": \"Printing\"}");
+  };
+}
+
+static void addPrinters(OctoprintFarm &farm, int count) {
+  for (int i = 0; i < count; i++)
+    CHECK_EQ(farm.addPrinter(IPAddress(10, 0, 0, i), 80, "key"), i);
+}
+
+TEST(printersShareThePool) {
+  silentOnes.clear();
+  OctoprintFarm farm;
+  for (int c = 0; c < 2; c++) {
+    serve(clients[c]);
+    clients[c].responseDelay = 50;
+    farm.addClient(clients[c]);
+  }
+  addPrinters(farm, 4);
+
+  farm.refresh();
+  CHECK(farm.poll());
+  // two clients, so two printers are under way and the other two wait for one to come free
+  CHECK_EQ(clients[0].requests.size(), (size_t)1);
+  CHECK_EQ(clients[1].requests.size(), (size_t)1);
+  while (farm.poll())
+    ;
+  for (int i = 0; i < 4; i++) {
+    CHECK(farm.printers[i].online);
+    CHECK_EQ(farm.printers[i].printJob.jobFileName, "printer" + String(i) + ".gcode");
+  }
+  CHECK_EQ(clients[0].requests.size() + clients[1].requests.size(), (size_t)8);  // printer and job for each
+  CHECK_EQ(clients[0].requests.size(), (size_t)4);
+}
+
+TEST(printersKeepTheirClient) {
+  silentOnes.clear();
+  OctoprintFarm farm;
+  for (int c = 0; c < 2; c++) {
+    serve(clients[c]);
+    farm.addClient(clients[c]);
+  }
+  addPrinters(farm, 2);
+  CHECK_EQ(farm.update(), 2);
+  IPAddress first[2] = {clients[0].lastIp, clients[1].lastIp};
+  CHECK(first[0] != first[1]);
+  CHECK_EQ(farm.update(), 2);
+  CHECK_EQ(farm.update(), 2);
+  // each printer stays on its client and its kept-alive connection
+  for (int c = 0; c < 2; c++) {
+    CHECK_EQ(clients[c].connects, 1UL);
+    CHECK_EQ(clients[c].requests.size(), (size_t)6);
+    CHECK(clients[c].lastIp == first[c]);
+  }
+}
+
+TEST(refusedPrinterReleasesItsClient) {
+  silentOnes.clear();
+  OctoprintFarm farm;
+  serve(clients[0]);
+  farm.addClient(clients[0]);
+  addPrinters(farm, 3);
+  clients[0].failConnects = 1;  // printer 0 is switched off
+  CHECK_EQ(farm.update(), 2);
+  CHECK(!farm.printers[0].online);
+  CHECK(farm.printers[1].online);
+  CHECK(farm.printers[2].online);
+}
+
+TEST(silentPrinterTimesOutAndReleasesItsClient) {
+  silentOnes = {1};
+  OctoprintFarm farm;
+  for (int c = 0; c < 2; c++) {
+    serve(clients[c]);
+    farm.addClient(clients[c]);
+  }
+  addPrinters(farm, 4);
+  unsigned long start = millis();
+  CHECK_EQ(farm.update(), 3);
+  CHECK(!farm.printers[1].online);
+  CHECK(millis() - start >= OPAPI_TIMEOUT);
+  CHECK(millis() - start < 2 * OPAPI_TIMEOUT);  // the others were not held up behind it
+  // the client it blocked took printer 2 or 3 afterwards, so both pool members did work
+  CHECK(clients[0].requests.size() > 0);
+  CHECK(clients[1].requests.size() > 1);
+
+  silentOnes.clear();
+  CHECK_EQ(farm.update(), 4);  // back once it answers again
+}
@@ -0,0 +1,140 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Compressed responses (OPAPI_GZIP): gzip, zlib and raw deflate bodies compressed here with zlib.
+#include <zlib.h>
+
+#include "MockClient.h"
+#include "alloc.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  return instance;
+}
+
+// windowBits as for deflateInit2(): 8..15 zlib, +16 gzip, negative raw deflate.
+static std::string compress(const std::string &text, int windowBits, int level = 9) {
+  z_stream stream = {};
+  deflateInit2(&stream, level, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, text.size()) + 32, '\0');
+  stream.next_in   = (Bytef *)text.data();
+  stream.avail_in  = text.size();
+  stream.next_out  = (Bytef *)&out[0];
+  stream.avail_out = out.size();
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+static std::string encoded(const char *encoding, const std::string &body, size_t chunkSize = 0) {
+  return httpResponse(200, body, std::string("Content-Encoding: ") + encoding + "\r\n", chunkSize);
+}
+
+TEST(asksForCompression) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(client.requests[0].header("Accept-Encoding"), std::string("gzip, deflate"));
+}
+
+TEST(everyWrapperAndFraming) {
+  struct {
+    const char *encoding;
+    int windowBits;
+  } formats[] = {{"gzip", 12 + 16}, {"deflate", 12}, {"deflate", -12}};
+  const size_t fragments[] = {0, 1, 7};
+  const size_t chunks[]    = {0, 5, 100};
+  std::string body         = recorded("job.json");
+  for (auto &format : formats) {
+    for (int level : {0, 1, 9}) {
+      std::string compressed = compress(body, format.windowBits, level);
+      for (size_t fragment : fragments) {
+        for (size_t chunk : chunks) {
+          OctoprintApi &octoprint = api();
+          client.fragment         = fragment;
+          client.route("/api/job", encoded(format.encoding, compressed, chunk));
+          octoprint.printJob.progressPrintTimeLeft = 0;
+          bool parsed                              = octoprint.getPrintJob();
+          CHECK(parsed);
+          CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+          if (!parsed)
+            printf("  %s window %d level %d fragment %zu chunk %zu\n", format.encoding, format.windowBits, level, fragment, chunk);
+        }
+      }
+    }
+  }
+}
+
+TEST(keepAliveSurvivesCompression) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/job", encoded("gzip", compress(recorded("job.json"), 12 + 16)));
+  client.route("/api/printer", encoded("deflate", compress(recorded("printer.json"), 12), 64));
+  for (int i = 0; i < 3; i++) {
+    CHECK(octoprint.getPrintJob());
+    CHECK(octoprint.getPrinterStatistics());
+  }
+  CHECK_EQ(client.connects, 1UL);
+  CHECK_EQ(octoprint.printerStats.printerToolCount, (uint8_t)3);
+  octoprint.setKeepAlive(false);
+}
+
+TEST(asyncRequests) {
+  OctoprintApi &octoprint = api();
+  client.fragment         = 3;
+  client.route("/api/printer", encoded("gzip", compress(recorded("printer.json"), 12 + 16)));
+  CHECK(octoprint.beginGetPrinterStatistics());
+  while (octoprint.poll())
+    ;
+  CHECK(octoprint.requestSucceeded());
+  CHECK_NEAR(octoprint.printerStats.printerBedTempActual, 59.8, 0.01);
+}
+
+// A server compressing with a 32K window may refer further back than OPAPI_INFLATE_WINDOW keeps: fail, don't crash.
+TEST(windowTooLargeFailsCleanly) {
+  if (OPAPI_INFLATE_WINDOW >= 32768)
+    return;
+  std::string block;
+  uint32_t seed = 1;
+  for (int i = 0; i < 6000; i++) {
+    seed = seed * 1103515245 + 12345;
+    block += (char)('a' + (seed >> 16) % 26);
+  }
+  std::string body = "{\"text\": \"" + block + block + "\"}";
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", encoded("gzip", compress(body, 15 + 16)));
+  CHECK(!octoprint.getPrintJob());
+}
+
+// The decoder is only allocated once a compressed response comes in, then kept for the next one.
+TEST(inflaterIsAllocatedOnFirstUse) {
+  CHECK(sizeof(OctoprintApi) < OPAPI_INFLATE_WINDOW);
+  OctoprintApi octoprint(client, IPAddress(10, 0, 0, 2), 80, "key");
+  client.reset();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  allocReset();
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(allocRead().peak < OPAPI_INFLATE_WINDOW);
+
+  client.route("/api/version", encoded("gzip", compress(recorded("version.json"), 12 + 16)));
+  allocReset();
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(allocRead().bytes >= OPAPI_INFLATE_WINDOW);
+  allocReset();
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(allocRead().bytes < OPAPI_INFLATE_WINDOW);
+  CHECK_EQ(octoprint.octoprintVer.octoprintServer, String("1.9.3"));
+}
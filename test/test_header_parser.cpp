@@ -0,0 +1,92 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintResponseParser: what it finds in the headers, and that it never touches the heap doing so.
+#include "OctoPrintAPI.h"
+#include "alloc.h"
+#include "test.h"
+
+static bool feed(OctoprintResponseParser &parser, const char *headers) {
+  parser.reset();
+  bool done = false;
+  for (const char *c = headers; *c && !done; c++)
+    done = parser.parse(*c);
+  return done;
+}
+
+TEST(statusLineAndLength) {
+  OctoprintResponseParser parser;
+  CHECK(feed(parser, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 1234\r\n\r\n"));
+  CHECK_EQ(parser.statusCode, 200);
+  CHECK_EQ(parser.contentLength, 1234L);
+  CHECK_EQ(parser.contentType, OPAPI_CONTENT_JSON);
+  CHECK(!parser.chunked);
+  CHECK(parser.keepAlive);
+}
+
+TEST(namesAndValuesAreCaseInsensitive) {
+  OctoprintResponseParser parser;
+  CHECK(feed(parser, "HTTP/1.1 409 CONFLICT\r\nCONTENT-LENGTH:  26\r\ntransfer-encoding: Chunked\r\nConnection: Close\r\n"
+                     "content-type: TEXT/html; charset=utf-8\r\n\r\n"));
+  CHECK_EQ(parser.statusCode, 409);
+  CHECK_EQ(parser.contentLength, 26L);
+  CHECK(parser.chunked);
+  CHECK(!parser.keepAlive);
+  CHECK_EQ(parser.contentType, OPAPI_CONTENT_TEXT);
+}
+
+TEST(http10ClosesUnlessToldOtherwise) {
+  OctoprintResponseParser parser;
+  CHECK(feed(parser, "HTTP/1.0 200 OK\r\n\r\n"));
+  CHECK(!parser.keepAlive);
+  CHECK(feed(parser, "HTTP/1.0 200 OK\r\nConnection: keep-alive\r\nKeep-Alive: timeout=15, max=99\r\n\r\n"));
+  CHECK(parser.keepAlive);
+  CHECK_EQ(parser.keepAliveTimeout, 15L);
+  CHECK_EQ(parser.keepAliveMax, 99L);
+}
+
+TEST(validatorsKeepTheirCase) {
+  OctoprintResponseParser parser;
+  CHECK(feed(parser, "HTTP/1.1 200 OK\r\nETag: \"A1b2C3\"\r\nLast-Modified: Sat, 14 Oct 2023 13:12:25 GMT\r\n\r\n"));
+  CHECK_EQ(std::string(parser.etag), std::string("\"A1b2C3\""));
+  CHECK_EQ(std::string(parser.lastModified), std::string("Sat, 14 Oct 2023 13:12:25 GMT"));
+}
+
+TEST(bareNewlinesAndLongHeaders) {
+  OctoprintResponseParser parser;
+  std::string cookie(300, 'x');
+  std::string headers = "HTTP/1.1 204 NO CONTENT\nSet-Cookie: " + cookie + "\nX-A-Very-Long-Header-Name-Indeed-Longer-Than-The-Buffer: 1\nContent-Length: 0\n\n";
+  CHECK(feed(parser, headers.c_str()));
+  CHECK_EQ(parser.statusCode, 204);
+  CHECK_EQ(parser.contentLength, 0L);
+}
+
+TEST(unfinishedHeadersAreNotDone) {
+  OctoprintResponseParser parser;
+  CHECK(!feed(parser, "HTTP/1.1 200 OK\r\nContent-Length: 12\r\n"));
+  CHECK(parser.started());
+  CHECK(!parser.finished());
+  parser.reset();
+  CHECK(!parser.started());
+}
+
+// The point of the parser: nothing is allocated however long or numerous the headers are.
+TEST(parsingAllocatesNothing) {
+  std::string headers = "HTTP/1.1 200 OK\r\nServer: nginx\r\nDate: Sat, 14 Oct 2023 13:12:25 GMT\r\n"
+                        "Content-Type: application/json\r\nContent-Length: 1434\r\nConnection: keep-alive\r\n"
+                        "Keep-Alive: timeout=5\r\nETag: \"9f3a\"\r\nCache-Control: no-cache\r\n"
+                        "Set-Cookie: session_P80=" + std::string(200, 'z') + "; Path=/; HttpOnly\r\n\r\n";
+  OctoprintResponseParser parser;
+  allocReset();
+  for (int i = 0; i < 100; i++)
+    feed(parser, headers.c_str());
+  allocStats stats = allocRead();
+  CHECK_EQ(stats.allocations, (size_t)0);
+  CHECK_EQ(parser.contentLength, 1434L);
+}
@@ -0,0 +1,114 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintTemperatureHistory against a server that keeps taking samples, with a ring of 8 to see it wrap.
+#include "MockClient.h"
+#include "OctoprintTemperatureHistory.h"
+#include "test.h"
+
+static MockClient client;
+static int taken;  // samples the server has taken so far, sample k at 1700000000 + 2k
+
+static long sampleTime(int k) { return 1700000000L + 2 * k; }
+
+// The newest limit samples, oldest first like OctoPrint sends them.
+static std::string history(const mockRequest &request) {
+  size_t at = request.target.find("limit=");
+  int limit = at == std::string::npos ? taken : atoi(request.target.c_str() + at + 6);
+  std::string samples;
+  for (int k = limit < taken ? taken - limit : 0; k < taken; k++) {
+    char sample[160];
+    snprintf(sample, sizeof(sample),
+             "%s{\"time\": %ld, \"bed\": {\"actual\": %d.5, \"target\": 60.0}, \"tool0\": {\"actual\": %d.5, \"target\": 215.0}}",
+             samples.empty() ? "" : ", ", sampleTime(k), 20 + k, 100 + k);
+    samples += sample;
+  }
+  return httpResponse(200, "{\"temperature\": {\"bed\": {\"actual\": 60.0, \"target\": 60.0}}, \"history\": [" + samples + "]}");
+}
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  client.handler = history;
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  return instance;
+}
+
+static int limitAsked() {
+  const std::string &target = client.requests.back().target;
+  return atoi(target.c_str() + target.find("limit=") + 6);
+}
+
+// The ring holds samples first to first + count() - 1, oldest first.
+static void checkSamples(OctoprintTemperatureHistory &temperatures, int first) {
+  for (uint16_t i = 0; i < temperatures.count(); i++) {
+    CHECK_EQ(temperatures.time(i), sampleTime(first + i));
+    CHECK_NEAR(temperatures.bedActual(i), 20.5 + first + i, 0.01);
+    CHECK_NEAR(temperatures.toolActual(0, i), 100.5 + first + i, 0.01);
+  }
+}
+
+TEST(firstUpdateFillsTheRing) {
+  OctoprintTemperatureHistory temperatures(api());
+  taken = 20;
+  CHECK(temperatures.update());
+  CHECK_EQ(limitAsked(), OPAPI_HISTORY_SIZE);
+  CHECK_EQ(temperatures.count(), (uint16_t)OPAPI_HISTORY_SIZE);
+  checkSamples(temperatures, 20 - OPAPI_HISTORY_SIZE);
+}
+
+TEST(laterUpdatesAskForTheElapsedTime) {
+  OctoprintTemperatureHistory temperatures(api());
+  taken = 3;
+  CHECK(temperatures.update());
+  CHECK_EQ(temperatures.count(), (uint16_t)3);
+
+  advanceMillis(4000);
+  taken += 2;
+  CHECK(temperatures.update());
+  CHECK_EQ(limitAsked(), 4 + 2);
+  CHECK_EQ(temperatures.count(), (uint16_t)5);  // the 3 already stored came again and were dropped
+  checkSamples(temperatures, 0);
+}
+
+TEST(duplicateTimestampsAreDropped) {
+  OctoprintTemperatureHistory temperatures(api());
+  taken = 5;
+  CHECK(temperatures.update());
+  advanceMillis(1000);
+  CHECK(temperatures.update());  // nothing new on the server
+  CHECK_EQ(limitAsked(), 3);
+  CHECK_EQ(temperatures.count(), (uint16_t)5);
+  checkSamples(temperatures, 0);
+}
+
+TEST(ringWrapsAround) {
+  OctoprintTemperatureHistory temperatures(api());
+  taken = 2;
+  CHECK(temperatures.update());
+  for (int round = 0; round < 3 * OPAPI_HISTORY_SIZE; round++) {
+    advanceMillis(2000 + 500 * (round % 3));
+    taken += 1 + round % 2;
+    CHECK(temperatures.update());
+    CHECK_EQ(temperatures.time(temperatures.count() - 1), sampleTime(taken - 1));
+  }
+  CHECK_EQ(temperatures.count(), (uint16_t)OPAPI_HISTORY_SIZE);
+  checkSamples(temperatures, taken - OPAPI_HISTORY_SIZE);
+}
+
+TEST(longPauseIsCappedAtTheRing) {
+  OctoprintTemperatureHistory temperatures(api());
+  taken = 4;
+  CHECK(temperatures.update());
+  advanceMillis(600000);
+  taken += 300;
+  CHECK(temperatures.update());
+  CHECK_EQ(limitAsked(), OPAPI_HISTORY_SIZE);
+  checkSamples(temperatures, taken - OPAPI_HISTORY_SIZE);
+}
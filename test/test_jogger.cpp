@@ -0,0 +1,107 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintJogger: a rotary encoder's steps merged into a few jogs.
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  client.route("/api/printer/printhead", httpResponse(204, ""));
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  instance.setKeepAlive(true);
+  advanceMillis(OPAPI_JOG_INTERVAL);  // well past boot, a new jogger may jog at once
+  return instance;
+}
+
+// An axis of a recorded jog, 0 when it is left out.
+static double axis(const mockRequest &request, const char *name) {
+  std::string key = std::string("\"") + name + "\": ";
+  size_t at       = request.body.find(key);
+  return at == std::string::npos ? 0 : atof(request.body.c_str() + at + key.size());
+}
+
+static void settle(OctoprintJogger &jogger, OctoprintApi &octoprint) {
+  for (int i = 0; i < 1000 && (jogger.pending() || octoprint.requestInProgress()); i++) {
+    jogger.poll();
+    advanceMillis(1);
+  }
+}
+
+// 70 steps of 0.1 mm, one every 5 ms: one jog per 100 ms interval while the knob turns, the rest right after.
+TEST(encoderStepsAreMerged) {
+  OctoprintApi &octoprint = api();
+  OctoprintJogger jogger(octoprint);
+  int sent            = 0;
+  int steps           = 0;
+  unsigned long start = millis();
+  while (steps < 70) {
+    for (; steps < 70 && millis() - start >= 5UL * steps; steps++)
+      jogger.move(0.1, 0, 0);
+    sent += jogger.poll();
+    advanceMillis(1);
+  }
+  CHECK_EQ(sent, 4);
+  CHECK_EQ(client.requests.size(), (size_t)4);
+  settle(jogger, octoprint);
+  CHECK_EQ(client.requests.size(), (size_t)5);
+  CHECK_EQ(client.connects, 1UL);  // all on the kept-alive connection
+
+  const double expected[] = {0.1, 2.0, 2.0, 2.0, 0.9};
+  double total            = 0;
+  for (size_t i = 0; i < client.requests.size(); i++) {
+    CHECK_EQ(client.requests[i].target, std::string("/api/printer/printhead"));
+    CHECK_NEAR(axis(client.requests[i], "x"), expected[i], 0.0001);
+    CHECK_EQ(axis(client.requests[i], "y"), 0.0);
+    total += axis(client.requests[i], "x");
+  }
+  CHECK_NEAR(total, 7.0, 0.0001);
+}
+
+TEST(nothingIsSentBeforeTheAnswer) {
+  OctoprintApi &octoprint = api();
+  OctoprintJogger jogger(octoprint);
+  client.responseDelay = 250;
+  jogger.move(0, 0, 0.2);
+  CHECK(jogger.poll());
+  unsigned long start = millis();
+  for (int step = 0; step < 20; step++) {
+    jogger.move(0, 0, 0.1);
+    CHECK(!jogger.poll());  // the first jog is still waiting for its answer
+    advanceMillis(10);
+  }
+  CHECK(millis() - start < 250);
+  client.responseDelay = 0;
+  settle(jogger, octoprint);
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_NEAR(axis(client.requests[1], "z"), 2.0, 0.0001);
+}
+
+TEST(refusedOffsetsAreDropped) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer/printhead", httpResponse(409, "{\"error\": \"Printer is currently printing\"}"));
+  OctoprintJogger jogger(octoprint);
+  jogger.move(5, 0, 0);
+  CHECK(jogger.poll());
+  settle(jogger, octoprint);
+  CHECK_EQ(octoprint.httpStatusCode, 409);
+  CHECK(!jogger.pending());
+
+  client.route("/api/printer/printhead", httpResponse(204, ""));
+  advanceMillis(OPAPI_JOG_INTERVAL);
+  jogger.move(0, 1.5, 0);
+  settle(jogger, octoprint);
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(axis(client.requests[1], "x"), 0.0);  // the refused 5 mm are not replayed
+  CHECK_NEAR(axis(client.requests[1], "y"), 1.5, 0.0001);
+}
@@ -0,0 +1,74 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// Request metrics, built with OPAPI_METRICS.
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+enum { JOB = 0, PRINTER = 1, VERSION = 5 };
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  instance.setKeepAlive(true);
+  instance.resetMetrics();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  return instance;
+}
+
+TEST(requestsAreCountedPerEndpoint) {
+  OctoprintApi &octoprint = api();
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(octoprint.getPrinterStatistics());
+  CHECK(octoprint.getPrinterStatistics());
+  CHECK_EQ(octoprint.metrics.endpoints[VERSION].requests, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[PRINTER].requests, 2U);
+  CHECK_EQ(octoprint.metrics.endpoints[PRINTER].connectFailures, 0U);
+  CHECK(octoprint.metrics.endpoints[PRINTER].bytesIn > 0);
+  CHECK(octoprint.metrics.endpoints[PRINTER].bytesOut > 0);
+}
+
+TEST(asyncRequestsAreCounted) {
+  OctoprintApi &octoprint = api();
+  CHECK(octoprint.beginGetPrintJob());
+  while (octoprint.poll())
+    ;
+  CHECK(octoprint.requestSucceeded());
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].requests, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].connectFailures, 0U);
+}
+
+// A begin...() that cannot connect has to close its record, or the next request is booked to the wrong endpoint.
+TEST(failedAsyncConnectIsClosed) {
+  OctoprintApi &octoprint = api();
+  client.failConnects = 1;
+  CHECK(!octoprint.beginGetPrintJob());
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].requests, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].connectFailures, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].lastError, -1);
+
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(octoprint.metrics.endpoints[VERSION].requests, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[VERSION].connectFailures, 0U);
+  CHECK_EQ(octoprint.metrics.endpoints[JOB].requests, 1U);
+}
+
+TEST(failedConnectIsCounted) {
+  OctoprintApi &octoprint = api();
+  client.failConnects = 1;
+  CHECK(!octoprint.getPrinterStatistics());
+  CHECK_EQ(octoprint.metrics.endpoints[PRINTER].requests, 1U);
+  CHECK_EQ(octoprint.metrics.endpoints[PRINTER].connectFailures, 1U);
+}
@@ -0,0 +1,59 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintProgress: extrapolating completion and time left between polls.
+#include "OctoprintProgress.h"
+#include "test.h"
+
+static printJobCall printing(long filepos, long printTime, long printTimeLeft, const char *origin) {
+  printJobCall job;
+  job.printerState                = "Printing";
+  job.jobFileSize                 = 100000;
+  job.jobFileDate                 = 1700000000;
+  job.progressFilepos             = filepos;
+  job.progressPrintTime           = printTime;
+  job.progressPrintTimeLeft       = printTimeLeft;
+  job.progressprintTimeLeftOrigin = origin;
+  return job;
+}
+
+TEST(extrapolatesBetweenPolls) {
+  OctoprintProgress progress;
+  progress.update(printing(10000, 100, 1000, "estimate"));
+  CHECK(progress.printing());
+  CHECK_NEAR(progress.completion(), 10.0, 0.01);
+  advanceMillis(10000);
+  CHECK_NEAR(progress.completion(), 11.0, 0.01);  // 100 bytes a second so far
+  CHECK_EQ(progress.printTime(), 110L);
+  CHECK_EQ(progress.printTimeLeft(), 990L);
+}
+
+// printTimeLeft null (-1 in printJob) is OctoPrint without an estimate yet, not a finished print.
+TEST(missingEstimateIsUnknown) {
+  OctoprintProgress progress;
+  progress.update(printing(10000, 100, -1, ""));
+  CHECK_EQ(progress.printTimeLeft(), 900L);  // worked out from the reading rate instead
+  progress.update(printing(99900, 999, 0, "estimate"));
+  CHECK_EQ(progress.printTimeLeft(), 0L);  // a real 0 from OctoPrint is still taken as it is
+}
+
+TEST(noEstimateAtAllIsMinusOne) {
+  OctoprintProgress progress;
+  printJobCall idle;
+  idle.printerState          = "Operational";
+  idle.jobFileSize           = 0;
+  idle.jobFileDate           = 0;
+  idle.progressFilepos       = 0;
+  idle.progressPrintTime     = 0;
+  idle.progressPrintTimeLeft = -1;
+  progress.update(idle);
+  CHECK(!progress.printing());
+  CHECK_EQ(progress.printTimeLeft(), -1L);
+  CHECK_EQ(progress.etaDrift(), 0L);
+}
@@ -0,0 +1,197 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintPushClient against a scripted OctoPrint: login, the WebSocket upgrade, pushed messages and control frames.
+#include "MockClient.h"
+#include "OctoprintPushClient.h"
+#include "test.h"
+
+static MockClient client;
+
+enum {
+  TEXT  = 0x1,
+  CLOSE = 0x8,
+  PING  = 0x9,
+  PONG  = 0xA
+};
+
+// An unmasked frame, as a server sends it.
+static std::string frame(uint8_t opcode, const std::string &payload) {
+  std::string bytes(1, (char)(0x80 | opcode));
+  if (payload.size() < 126)
+    bytes += (char)payload.size();
+  else {
+    bytes += (char)126;
+    bytes += (char)(payload.size() >> 8);
+    bytes += (char)(payload.size() & 0xFF);
+  }
+  return bytes + payload;
+}
+
+struct sentFrame {
+  uint8_t opcode;
+  std::string payload;
+};
+
+// Unmasks the frames the client wrote, false when one of them is malformed or not masked.
+static bool sentFrames(const std::string &bytes, std::vector<sentFrame> &frames) {
+  frames.clear();
+  size_t at = 0;
+  while (at < bytes.size()) {
+    if (bytes.size() - at < 6 || !(bytes[at] & 0x80) || !(bytes[at + 1] & 0x80))
+      return false;
+    sentFrame sent;
+    sent.opcode   = bytes[at] & 0x0F;
+    size_t length = bytes[at + 1] & 0x7F;
+    at += 2;
+    if (length == 126) {
+      length = ((uint8_t)bytes[at] << 8) | (uint8_t)bytes[at + 1];
+      at += 2;
+    }
+    const std::string mask = bytes.substr(at, 4);
+    at += 4;
+    if (bytes.size() - at < length)
+      return false;
+    for (size_t i = 0; i < length; i++)
+      sent.payload += bytes[at + i] ^ mask[i & 3];
+    at += length;
+    frames.push_back(sent);
+  }
+  return true;
+}
+
+static const std::string current =
+    "{\"current\": {\"state\": {\"text\": \"Printing\", \"flags\": {\"operational\": true, \"printing\": true, \"ready\": true}},"
+    " \"job\": {\"file\": {\"name\": \"benchy.gcode\", \"origin\": \"local\", \"size\": 1843200, \"date\": 1700000000},"
+    " \"estimatedPrintTime\": 5400},"
+    " \"progress\": {\"completion\": 42.5, \"filepos\": 783360, \"printTime\": 2295, \"printTimeLeft\": 3105,"
+    " \"printTimeLeftOrigin\": \"estimate\"},"
+    " \"temps\": [{\"time\": 1700002295, \"bed\": {\"actual\": 59.8, \"target\": 60.0},"
+    " \"tool0\": {\"actual\": 214.6, \"target\": 215.0}}],"
+    " \"logs\": [\"Send: N1234 G1 X10\"], \"messages\": [], \"busyFiles\": []}}";
+
+// OctoPrint logging in the passive session, then answering the upgrade with accept, by default the right one.
+static void script(const char *accept = NULL) {
+  client.reset();
+  client.handler = [accept](const mockRequest &request) {
+    if (request.target == "/api/login")
+      return httpResponse(200, "{\"name\": \"_api\", \"session\": \"f00d\", \"active\": true}");
+    char expected[29];
+    OctoprintWebSocket::acceptKey(request.header("Sec-WebSocket-Key").c_str(), expected);
+    return std::string("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n") +
+           "Sec-WebSocket-Accept: " + (accept ? accept : expected) + "\r\n\r\n";
+  };
+}
+
+// The example of RFC 6455 section 1.3.
+TEST(acceptKeyMatchesTheRfc) {
+  char accept[29];
+  OctoprintWebSocket::acceptKey("dGhlIHNhbXBsZSBub25jZQ==", accept);
+  CHECK_EQ(std::string(accept), std::string("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+}
+
+TEST(connectsAndAuthenticates) {
+  script();
+  OctoprintPushClient push(client, IPAddress(10, 0, 0, 2), 80, "key");
+  CHECK(push.connect());
+  CHECK(push.connected());
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(client.requests[0].body, std::string("{\"passive\": true}"));
+  CHECK_EQ(client.requests[1].target, std::string("/sockjs/websocket"));
+  CHECK_EQ(client.requests[1].header("Sec-WebSocket-Key").size(), (size_t)24);
+
+  std::vector<sentFrame> frames;
+  CHECK(sentFrames(client.upgraded, frames));
+  CHECK_EQ(frames.size(), (size_t)1);
+  CHECK_EQ(frames[0].opcode, (uint8_t)TEXT);
+  CHECK_EQ(frames[0].payload, std::string("{\"auth\": \"_api:f00d\"}"));
+  CHECK_EQ(client.writes, 3UL);  // login, upgrade and the auth frame, each in one write
+}
+
+TEST(wrongAcceptIsRefused) {
+  script("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+  OctoprintPushClient push(client, IPAddress(10, 0, 0, 2), 80, "key");
+  CHECK(!push.connect());
+  CHECK(!push.connected());
+  CHECK(client.upgraded.empty());
+}
+
+static int printerCallbacks;
+static int jobCallbacks;
+
+TEST(pushedMessagesFillTheStructs) {
+  script();
+  OctoprintPushClient push(client, IPAddress(10, 0, 0, 2), 80, "key");
+  printerCallbacks = jobCallbacks = 0;
+  push.onPrinterStatistics([](OctoprintPushClient *) { printerCallbacks++; });
+  push.onPrintJob([](OctoprintPushClient *) { jobCallbacks++; });
+  CHECK(push.connect());
+
+  client.push(frame(TEXT, "{\"connected\": {\"version\": \"1.9.3\", \"apikey\": null}}"));
+  CHECK(!push.poll());  // read through and dropped
+  client.push(frame(TEXT, current));
+  CHECK(push.poll());
+  CHECK_EQ(push.printerStats.printerState, String("Printing"));
+  CHECK(push.printerStats.printerStatePrinting);
+  CHECK(push.printerStats.printerBedAvailable);
+  CHECK_NEAR(push.printerStats.printerBedTempActual, 59.8, 0.01);
+  CHECK_NEAR(push.printerStats.printerToolTempActual[0], 214.6, 0.01);
+  CHECK_EQ(push.printJob.printerState, String("Printing"));
+  CHECK_EQ(push.printJob.jobFileName, String("benchy.gcode"));
+  CHECK_EQ(push.printJob.jobFileSize, 1843200L);
+  CHECK_NEAR(push.printJob.progressCompletion, 42.5, 0.01);
+  CHECK_EQ(push.printJob.progressPrintTimeLeft, 3105L);
+  CHECK_EQ(printerCallbacks, 1);
+  CHECK_EQ(jobCallbacks, 1);
+
+  client.push(frame(TEXT, current));
+  CHECK(!push.poll());  // nothing changed, no callbacks
+  CHECK_EQ(printerCallbacks, 1);
+  CHECK_EQ(jobCallbacks, 1);
+}
+
+TEST(pingIsAnsweredAndCloseHonoured) {
+  script();
+  OctoprintPushClient push(client, IPAddress(10, 0, 0, 2), 80, "key");
+  CHECK(push.connect());
+  client.upgraded.clear();
+
+  client.push(frame(PING, "hb-1") + frame(TEXT, current));
+  CHECK(push.poll());  // the ping in front of the message is answered on the way
+  std::vector<sentFrame> frames;
+  CHECK(sentFrames(client.upgraded, frames));
+  CHECK_EQ(frames.size(), (size_t)1);
+  CHECK_EQ(frames[0].opcode, (uint8_t)PONG);
+  CHECK_EQ(frames[0].payload, std::string("hb-1"));
+
+  client.upgraded.clear();
+  client.push(frame(CLOSE, std::string("\x03\xe8going away", 12)));
+  CHECK(!push.poll());
+  CHECK(!push.connected());
+  CHECK(sentFrames(client.upgraded, frames));
+  CHECK_EQ(frames.size(), (size_t)1);
+  CHECK_EQ(frames[0].opcode, (uint8_t)CLOSE);
+  CHECK_EQ(frames[0].payload, std::string("\x03\xe8", 2));  // the status code echoed
+  CHECK_EQ(client.stops, 2UL);                                // the login connection and the socket
+}
+
+TEST(partialWritesSendWholeFrames) {
+  script();
+  OctoprintPushClient push(client, IPAddress(10, 0, 0, 2), 80, "key");
+  CHECK(push.connect());
+  client.upgraded.clear();
+  client.writeLimit = 3;
+  client.zeroWrites = 2;
+  CHECK(push.setThrottle(2));
+  client.writeLimit = 0;
+  std::vector<sentFrame> frames;
+  CHECK(sentFrames(client.upgraded, frames));
+  CHECK_EQ(frames.size(), (size_t)1);
+  CHECK_EQ(frames[0].payload, std::string("{\"throttle\": 2}"));
+}
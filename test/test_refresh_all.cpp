@@ -0,0 +1,104 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// refreshAll() against the four getters it replaces, on a link where connects and answers take time.
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  client.connectDelay  = 40;  // TCP (and on most boards no TLS) handshake
+  client.responseDelay = 25;  // OctoPrint's own time to answer
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  client.route("/api/printer?history=true&limit=2", httpResponse(200, recorded("printer_history.json")));
+  client.route("/api/printer/bed", httpResponse(200, recorded("printer_bed.json")));
+  client.route("/api/printer/sd", httpResponse(200, recorded("printer_sd.json")));
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  return instance;
+}
+
+struct cycle {
+  size_t requests;
+  unsigned long connects;
+  unsigned long ms;
+};
+
+static cycle separateCalls() {
+  OctoprintApi &octoprint = api();
+  unsigned long start     = millis();
+  octoprint.getPrinterStatistics();
+  octoprint.getPrintJob();
+  octoprint.octoPrintGetPrinterBed();
+  octoprint.octoPrintGetPrinterSD();
+  return {client.requests.size(), client.connects, millis() - start};
+}
+
+static cycle refreshAll(bool &success) {
+  OctoprintApi &octoprint = api();
+  unsigned long start     = millis();
+  success                 = octoprint.refreshAll();
+  return {client.requests.size(), client.connects, millis() - start};
+}
+
+TEST(fewerRequestsAndConnections) {
+  cycle before = separateCalls();
+  bool success;
+  cycle after  = refreshAll(success);
+  printf("  per cycle  requests  connects  ms\n");
+  printf("  before     %8zu  %8lu  %lu\n", before.requests, before.connects, before.ms);
+  printf("  after      %8zu  %8lu  %lu\n", after.requests, after.connects, after.ms);
+  CHECK(success);
+  CHECK_EQ(before.requests, (size_t)4);
+  CHECK_EQ(after.requests, (size_t)2);
+  CHECK_EQ(after.connects, 1UL);
+  CHECK(after.ms * 2 < before.ms);
+}
+
+TEST(everythingFromOneSnapshot) {
+  OctoprintApi &octoprint = api();
+  CHECK(octoprint.refreshAll());
+  CHECK_EQ(client.requests[0].target, std::string("/api/printer?history=true&limit=2"));
+  CHECK_EQ(client.requests[1].target, std::string("/api/job"));
+  CHECK(octoprint.printerStats.printerStatesdReady);
+  CHECK_EQ(octoprint.printerStats.printerToolCount, (uint8_t)1);
+  CHECK_NEAR(octoprint.printerStats.printerBedTempActual, octoprint.printerBed.printerBedTempActual, 0.001);
+  CHECK_NEAR(octoprint.printerBed.printerBedTempTarget, 60, 0.01);
+  CHECK_EQ(octoprint.printerBed.printerBedTempHistoryTimestamp, 1697289145L);
+  CHECK_NEAR(octoprint.printerBed.printerBedTempHistoryActual, 59.8, 0.01);
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+}
+
+TEST(connectionIsClosedAfterwardsUnlessKeptAlive) {
+  OctoprintApi &octoprint = api();
+  CHECK(octoprint.refreshAll());
+  CHECK(!client.connected());
+  octoprint.setKeepAlive(true);
+  CHECK(octoprint.refreshAll());
+  CHECK(client.connected());
+  octoprint.setKeepAlive(false);
+}
+
+// Every history sample repeats all sensors, a few tools and a chamber must still fit in the document.
+TEST(historyOfEveryToolFits) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer?history=true&limit=2", httpResponse(200, recorded("printer_history_tools.json")));
+  CHECK(octoprint.refreshAll());
+  CHECK_EQ(octoprint.printerStats.printerToolCount, (uint8_t)3);
+  CHECK(octoprint.printerStats.printerChamberAvailable);
+  CHECK_NEAR(octoprint.printerStats.printerToolTempActual[2], 190.3, 0.01);
+  CHECK_NEAR(octoprint.printerStats.printerChamberTempActual, 31.4, 0.01);
+  CHECK_NEAR(octoprint.printerBed.printerBedTempTarget, 60, 0.01);
+  CHECK_EQ(octoprint.printerBed.printerBedTempHistoryTimestamp, 1697289145L);
+  CHECK_NEAR(octoprint.printerBed.printerBedTempHistoryActual, 59.8, 0.01);
+}
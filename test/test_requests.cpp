@@ -0,0 +1,464 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// The blocking getters against recorded OctoPrint responses, and how requests use the connection.
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(192, 168, 1, 20), 80, "0123456789ABCDEF");
+  instance.setKeepAlive(false);
+  return instance;
+}
+
+TEST(version) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(octoprint.octoprintVer.octoprintApi, String("0.1"));
+  CHECK_EQ(octoprint.octoprintVer.octoprintServer, String("1.9.3"));
+  CHECK_EQ(client.requests.size(), (size_t)1);
+  CHECK_EQ(client.requests[0].header("X-Api-Key"), std::string("0123456789ABCDEF"));
+  CHECK_EQ(client.requests[0].header("Host"), std::string("192.168.1.20"));
+}
+
+TEST(printerStatisticsGetter) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  CHECK(octoprint.getPrinterStatistics());
+  printerStatistics &stats = octoprint.printerStats;
+  CHECK_EQ(stats.printerState, String("Printing"));
+  CHECK(stats.printerStatePrinting);
+  CHECK(stats.printerStateoperational);
+  CHECK(!stats.printerStatepaused);
+  CHECK(stats.printerStatesdReady);
+  CHECK(stats.printerBedAvailable);
+  CHECK_NEAR(stats.printerBedTempActual, 59.8, 0.01);
+  CHECK_NEAR(stats.printerBedTempTarget, 60, 0.01);
+  CHECK(stats.printerChamberAvailable);
+  CHECK_NEAR(stats.printerChamberTempActual, 31.4, 0.01);
+  CHECK_EQ(stats.printerToolCount, (uint8_t)3);
+  CHECK_NEAR(stats.printerToolTempActual[2], 190.3, 0.01);
+  CHECK_NEAR(stats.printerTool0TempActual, 214.7, 0.01);
+  CHECK_NEAR(stats.printerTool1TempOffset, -2, 0.01);
+  CHECK(stats.printerTool1Available);
+}
+
+TEST(printerNotOperational) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer", httpResponse(409, "Printer is not operational", "Content-Type: text/html\r\n"));
+  CHECK(octoprint.getPrinterStatistics());
+  CHECK_EQ(octoprint.httpStatusCode, 409);
+  CHECK_EQ(octoprint.printerStats.printerState, String("Printer is not operational"));
+  CHECK(!octoprint.printerStats.printerStateoperational);
+}
+
+TEST(printJobGetter) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  CHECK(octoprint.getPrintJob());
+  printJobCall &job = octoprint.printJob;
+  CHECK_EQ(job.printerState, String("Printing"));
+  CHECK_EQ(job.jobFileName, String("benchy.gcode"));
+  CHECK_EQ(job.jobFilePath, String("parts/benchy.gcode"));
+  CHECK_EQ(job.jobFileOrigin, String("local"));
+  CHECK_EQ(job.jobFileSize, 4124833L);
+  CHECK_EQ(job.jobFileDate, 1697280051L);
+  CHECK_EQ(job.estimatedPrintTime, 8811L);
+  CHECK_NEAR(job.progressCompletion, 42.37, 0.001);
+  CHECK_EQ(job.progressFilepos, 1747681L);
+  CHECK_EQ(job.progressPrintTime, 3720L);
+  CHECK_EQ(job.progressPrintTimeLeft, 5104L);
+  CHECK_EQ(job.progressprintTimeLeftOrigin, String("estimate"));
+}
+
+// OctoPrint sends printTimeLeft null until it has an estimate, which must not read like a print about to end.
+TEST(printTimeLeftKeepsNull) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job_idle.json")));
+  CHECK(octoprint.getPrintJob());
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, -1L);
+  client.route("/api/job", httpResponse(200, "{\"state\": \"Printing\", \"progress\": {\"printTimeLeft\": 0, \"printTimeLeftOrigin\": \"linear\"}}"));
+  CHECK(octoprint.getPrintJob());
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 0L);
+}
+
+TEST(bedAndSd) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer/bed", httpResponse(200, recorded("printer_bed.json")));
+  client.route("/api/printer/sd", httpResponse(200, recorded("printer_sd.json")));
+  CHECK(octoprint.octoPrintGetPrinterBed());
+  CHECK_NEAR(octoprint.printerBed.printerBedTempActual, 59.8, 0.01);
+  CHECK_EQ(octoprint.printerBed.printerBedTempHistoryTimestamp, 1697289145L);
+  CHECK_NEAR(octoprint.printerBed.printerBedTempHistoryActual, 59.8, 0.01);
+  octoprint.printerStats.printerStatesdReady = false;
+  CHECK(octoprint.octoPrintGetPrinterSD());
+  CHECK(octoprint.printerStats.printerStatesdReady);
+}
+
+static std::vector<std::string> listed;
+
+static bool collect(OctoprintApi *, const octoprintFile &file) {
+  listed.push_back(std::string(file.folder ? "+" : "") + file.name);
+  return true;
+}
+
+TEST(listFiles) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/files/local", httpResponse(200, recorded("files.json")));
+  listed.clear();
+  CHECK(octoprint.octoPrintListFiles(collect));
+  CHECK_EQ(listed.size(), (size_t)3);
+  if (listed.size() == 3) {
+    CHECK_EQ(listed[0], std::string("benchy.gcode"));
+    CHECK_EQ(listed[1], std::string("+parts"));
+    CHECK_EQ(listed[2], std::string("calibration cube.gcode"));
+  }
+  CHECK_EQ(client.requests[0].target, std::string("/api/files/local?recursive=false"));
+}
+
+static std::string fileName(int i) {
+  char name[16];
+  snprintf(name, sizeof(name), "file%02d.gcode", i);
+  return name;
+}
+
+// A folder of count files, file00.gcode onwards, answered the way OctoPrint answers for a folder.
+static std::string folderListing(const char *name, int count) {
+  std::string children;
+  for (int i = 0; i < count; i++) {
+    char entry[160];
+    snprintf(entry, sizeof(entry), "%s{\"name\": \"file%02d.gcode\", \"path\": \"%s/file%02d.gcode\", \"type\": \"machinecode\", \"size\": %d}",
+             i ? ", " : "", i, name, i, 1000 + i);
+    children += entry;
+  }
+  return std::string("{\"name\": \"") + name + "\", \"path\": \"" + name + "\", \"type\": \"folder\", \"children\": [" + children + "]}";
+}
+
+TEST(listFilesPagesThroughAFolder) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/files/local/my%20models", httpResponse(200, folderListing("my models", 25)));
+  for (int page = 0; page < 3; page++) {
+    listed.clear();
+    CHECK(octoprint.octoPrintListFiles(collect, "my models", page * 10, 10));
+    CHECK_EQ(listed.size(), (size_t)(page < 2 ? 10 : 5));
+    if (!listed.empty()) {
+      CHECK_EQ(listed.front(), fileName(page * 10));
+      CHECK_EQ(listed.back(), fileName(page * 10 + listed.size() - 1));
+    }
+  }
+  CHECK_EQ(client.requests[0].target, std::string("/api/files/local/my%20models?recursive=false"));
+}
+
+static bool firstThree(OctoprintApi *api, const octoprintFile &file) {
+  collect(api, file);
+  return listed.size() < 3;
+}
+
+// Stopping early drops the connection instead of reading the rest; the next request must not see the leftovers.
+TEST(listFilesStopsEarly) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/files/local/models", httpResponse(200, folderListing("models", 200)));
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  listed.clear();
+  CHECK(octoprint.octoPrintListFiles(firstThree, "models"));
+  CHECK_EQ(listed.size(), (size_t)3);
+  CHECK_EQ(client.stops, 1UL);
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(octoprint.octoprintVer.octoprintServer, String("1.9.3"));
+  CHECK_EQ(client.connects, 2UL);
+  octoprint.setKeepAlive(false);
+}
+
+// A listing read to the end keeps the kept-alive connection, the chunk trailer is drained before the next request.
+TEST(listFilesReadToTheEndKeepsTheConnection) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/files/local/models", httpResponse(200, folderListing("models", 12), "", 64));
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  listed.clear();
+  CHECK(octoprint.octoPrintListFiles(collect, "models"));
+  CHECK_EQ(listed.size(), (size_t)12);
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(octoprint.octoprintVer.octoprintServer, String("1.9.3"));
+  CHECK_EQ(client.connects, 1UL);
+  CHECK_EQ(client.stops, 0UL);
+  octoprint.setKeepAlive(false);
+}
+
+TEST(chunkedBody) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json"), "", 7));
+  CHECK(octoprint.getPrintJob());
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+  CHECK_EQ(octoprint.printJob.jobFileName, String("benchy.gcode"));
+}
+
+TEST(commandsTakeOneWrite) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(204, ""));
+  unsigned long before = client.writes;
+  CHECK(octoprint.octoPrintJobPause());
+  CHECK_EQ(client.writes - before, 1UL);
+  CHECK_EQ(client.requests[0].method, std::string("POST"));
+  CHECK_EQ(client.requests[0].body, std::string("{\"command\":\"pause\",\"action\":\"pause\"}"));
+}
+
+TEST(toolTemperaturesTakeOneRequest) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer/tool", httpResponse(204, ""));
+  const uint16_t targets[] = {215, 0, 195};
+  CHECK(octoprint.octoPrintSetToolTemperatures(targets, 3));
+  CHECK_EQ(client.requests.size(), (size_t)1);
+  CHECK_EQ(client.requests[0].method, std::string("POST"));
+  CHECK_EQ(client.requests[0].body, std::string("{ \"command\": \"target\", \"targets\": { \"tool0\": 215, \"tool1\": 0, \"tool2\": 195 } }"));
+
+  CHECK(!octoprint.octoPrintSetToolTemperatures(targets, 0));  // nothing to set, nothing sent
+  uint16_t many[POSTDATA_SIZE / 8] = {0};
+  CHECK(!octoprint.octoPrintSetToolTemperatures(many, sizeof(many) / sizeof(many[0])));  // would not fit
+  CHECK_EQ(client.requests.size(), (size_t)1);
+}
+
+// Tools past OPAPI_MAX_TOOLS are not kept, a tool missing in between still counts as a slot.
+TEST(toolsBeyondTheArraysAreIgnored) {
+  OctoprintApi &octoprint = api();
+  std::string temperature;
+  for (int tool = 0; tool <= OPAPI_MAX_TOOLS; tool++) {
+    if (tool == 1)
+      continue;
+    temperature += ", \"tool" + std::to_string(tool) + "\": {\"actual\": " + std::to_string(200 + tool) +
+                   ".5, \"target\": " + std::to_string(210 + tool) + ", \"offset\": " + std::to_string(-tool) + "}";
+  }
+  client.route("/api/printer", httpResponse(200, "{\"state\": {\"text\": \"Operational\", \"flags\": {\"operational\": true}},"
+                                                 " \"temperature\": {\"chamber\": {\"actual\": 28.0, \"target\": 35.0}" +
+                                                     temperature + "}}"));
+  CHECK(octoprint.getPrinterStatistics());
+  printerStatistics &stats = octoprint.printerStats;
+  CHECK_EQ(stats.printerToolCount, (uint8_t)OPAPI_MAX_TOOLS);
+  CHECK(!stats.printerBedAvailable);
+  CHECK(stats.printerChamberAvailable);
+  CHECK_NEAR(stats.printerChamberTempTarget, 35, 0.01);
+  CHECK_EQ(stats.printerToolTempActual[1], 0.0f);
+  for (int tool = 2; tool < OPAPI_MAX_TOOLS; tool++) {
+    CHECK_NEAR(stats.printerToolTempActual[tool], 200.5 + tool, 0.01);
+    CHECK_NEAR(stats.printerToolTempTarget[tool], 210 + tool, 0.01);
+    CHECK_NEAR(stats.printerToolTempOffset[tool], -tool, 0.01);
+  }
+}
+
+TEST(keepAliveReusesTheConnection) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  for (int i = 0; i < 5; i++)
+    CHECK(octoprint.getPrintJob());
+  CHECK_EQ(client.connects, 1UL);
+  CHECK_EQ(client.requests.size(), (size_t)5);
+  CHECK_EQ(client.requests[0].header("Connection"), std::string("keep-alive"));
+  octoprint.setKeepAlive(false);
+}
+
+TEST(staleConnectionIsRetriedOnce) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  CHECK(octoprint.getOctoprintVersion());
+  client.dropConnection();  // the server timed the idle connection out
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(client.connects, 2UL);
+  octoprint.setKeepAlive(false);
+}
+
+// The server takes the POST, then closes without an answer: the command may have run, so it is not sent again.
+TEST(postIsNotSentTwice) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  CHECK(octoprint.getOctoprintVersion());
+  client.handler = [](const mockRequest &) {
+    client.dropConnection();
+    return std::string();
+  };
+  CHECK(!octoprint.octoPrintJobPause());
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(client.requests[1].method, std::string("POST"));
+  CHECK_EQ(client.connects, 1UL);
+  octoprint.setKeepAlive(false);
+}
+
+// A POST that could not even be written on the stale socket never reached the server, that one is sent again.
+TEST(unwrittenPostIsRetried) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  client.route("/api/job", httpResponse(204, ""));
+  CHECK(octoprint.getOctoprintVersion());
+  client.dropConnection();
+  CHECK(octoprint.octoPrintJobPause());
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(client.connects, 2UL);
+  octoprint.setKeepAlive(false);
+}
+
+TEST(idleConnectionIsNotTrustedPastItsTimeout) {
+  OctoprintApi &octoprint = api();
+  octoprint.setKeepAlive(true);
+  client.route("/api/version", httpResponse(200, recorded("version.json"), "Keep-Alive: timeout=2\r\n"));
+  CHECK(octoprint.getOctoprintVersion());
+  advanceMillis(2500);
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(client.connects, 2UL);
+  octoprint.setKeepAlive(false);
+}
+
+TEST(unchangedBodyIsNotParsedAgain) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json"), "ETag: \"42\"\r\n"));
+  CHECK_EQ(octoprint.updatePrintJob(), OPAPI_UPDATE_CHANGED);
+  CHECK_EQ(octoprint.updatePrintJob(), OPAPI_UPDATE_UNCHANGED);
+  CHECK_EQ(client.requests[1].header("If-None-Match"), std::string("\"42\""));
+  client.route("/api/job", httpResponse(304, ""));
+  CHECK_EQ(octoprint.updatePrintJob(), OPAPI_UPDATE_UNCHANGED);
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+}
+
+TEST(refusedConnection) {
+  OctoprintApi &octoprint = api();
+  client.failConnects = 1;
+  CHECK(!octoprint.getPrintJob());
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK_EQ(client.requests.size(), (size_t)0);
+}
+
+TEST(silentServerTimesOut) {
+  OctoprintApi &octoprint = api();
+  client.silent        = true;
+  unsigned long before = millis();
+  CHECK(!octoprint.getPrintJob());
+  CHECK(millis() - before >= OPAPI_TIMEOUT);
+}
+
+TEST(rawRequests) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/settings", httpResponse(200, "{\"api\": {\"enabled\": true}}"));
+  CHECK_EQ(octoprint.getOctoprintEndpointResults("settings"), String("{\"api\": {\"enabled\": true}}"));
+  CHECK_EQ(octoprint.httpStatusCode, 200);
+  client.route("/api/printer/command", httpResponse(204, ""));
+  CHECK(octoprint.octoPrintPrinterCommand((char *)"M117 \"hi\""));
+  CHECK_EQ(client.requests[1].body, std::string("{\"command\": \"M117 \\\"hi\\\"\"}"));
+}
+
+static int lookups;
+static bool fakeLookup(const char *, IPAddress &ip) {
+  lookups++;
+  ip = IPAddress(192, 168, 1, 42);
+  return true;
+}
+
+// With a resolver the name is looked up once and the address reused, until OPAPI_DNS_TTL runs out or it stops answering.
+TEST(resolvedAddressIsReused) {
+  static char host[] = "octopi.local";
+  OctoprintApi octoprint;
+  client.reset();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  octoprint.init(client, host, 80, "0123456789ABCDEF");
+  lookups = 0;
+  octoprint.setResolver(fakeLookup);
+  CHECK(octoprint.resolveHost());
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(lookups, 1);
+  CHECK(client.lastHost.empty());
+  CHECK(client.lastIp == IPAddress(192, 168, 1, 42));
+
+  advanceMillis(OPAPI_DNS_TTL + 1);
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(lookups, 2);
+
+  client.failConnects = 1;
+  CHECK(!octoprint.getOctoprintVersion());
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(lookups, 3);
+  CHECK_EQ(octoprint.hostLookups, 3UL);
+}
+
+// A second line that only fits when the ", " in front of it is not counted must start a new batch.
+TEST(commandBatchNeverTruncates) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer/command", httpResponse(204, ""));
+  std::string first  = "M117 " + std::string(95, 'a');
+  std::string second = "M117 " + std::string(129, 'b');
+  OctoprintCommandBatch batch(octoprint);
+  CHECK(batch.add(first.c_str()));
+  CHECK(batch.add(second.c_str()));
+  CHECK(batch.flush());
+  CHECK_EQ(client.requests.size(), (size_t)2);
+  CHECK_EQ(client.requests[0].body, "{\"commands\": [\"" + first + "\"]}");
+  CHECK_EQ(client.requests[1].body, "{\"commands\": [\"" + second + "\"]}");
+
+  // and two short ones still share a POST
+  CHECK(batch.add("G28"));
+  CHECK(batch.add("G1 Z10"));
+  CHECK(batch.flush());
+  CHECK_EQ(client.requests.size(), (size_t)3);
+  CHECK_EQ(client.requests[2].body, std::string("{\"commands\": [\"G28\", \"G1 Z10\"]}"));
+}
+
+// A hostname goes to the client as it is unless a lookup was asked for, a TLS client needs it for SNI.
+TEST(hostnamesConnectByName) {
+  static char host[] = "octopi.local";
+  OctoprintApi octoprint;
+  client.reset();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  octoprint.init(client, host, 80, "0123456789ABCDEF");
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK_EQ(client.lastHost, std::string("octopi.local"));
+  CHECK_EQ(octoprint.hostLookups, 0UL);
+
+  lookups = 0;
+  octoprint.setResolver(fakeLookup);
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(octoprint.getOctoprintVersion());
+  CHECK(client.lastHost.empty());
+  CHECK(client.lastIp == IPAddress(192, 168, 1, 42));
+  CHECK_EQ(lookups, 1);
+}
+
+// Client::write() may take only part of the request, or nothing while the socket is backed up: all of it has to go out.
+TEST(partialWritesAreRetried) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer/command", httpResponse(204, ""));
+  std::string command = "M117 " + std::string(600, 'x');
+  client.writeLimit   = 50;
+  client.zeroWrites   = 5;
+  CHECK(octoprint.octoPrintPrinterCommand((char *)command.c_str()));
+  CHECK_EQ(client.requests.size(), (size_t)1);
+  CHECK_EQ(client.requests[0].body, "{\"command\": \"" + command + "\"}");
+  CHECK(client.writes > 10UL);
+  client.writeLimit = 0;
+}
+
+TEST(stuckWriteFails) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/version", httpResponse(200, recorded("version.json")));
+  client.zeroWrites    = 1000000;
+  unsigned long before = millis();
+  CHECK(!octoprint.getOctoprintVersion());
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK(client.requests.empty());
+  CHECK(millis() - before >= OPAPI_TIMEOUT);
+  client.zeroWrites = 0;
+}
@@ -0,0 +1,95 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintScheduler: polling rates and backing off while OctoPrint cannot be reached.
+#include "MockClient.h"
+#include "OctoprintScheduler.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  instance.setKeepAlive(true);
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  return instance;
+}
+
+// Ticks for ms of virtual time, one tick per ms.
+static void run(OctoprintScheduler &scheduler, unsigned long ms) {
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    scheduler.tick();
+    advanceMillis(1);
+  }
+}
+
+TEST(pollsBothEndpoints) {
+  OctoprintApi &octoprint = api();
+  OctoprintScheduler scheduler(octoprint);
+  uint8_t changed = 0;
+  for (int i = 0; i < 2000 && changed != (OPSCHED_PRINTER_STATISTICS | OPSCHED_PRINT_JOB); i++)
+    changed |= scheduler.tick();
+  CHECK_EQ(changed, (uint8_t)(OPSCHED_PRINTER_STATISTICS | OPSCHED_PRINT_JOB));
+  CHECK(scheduler.online());
+  CHECK_EQ(octoprint.printJob.progressPrintTimeLeft, 5104L);
+  CHECK(scheduler.nextPoll() > 0);
+}
+
+// A refused connect makes begin...() fail straight away, that has to back off like a failed answer does.
+TEST(refusedConnectsBackOff) {
+  OctoprintApi &octoprint = api();
+  OctoprintScheduler scheduler(octoprint);
+  client.failConnects = 1000000;
+  run(scheduler, 60000);
+  CHECK(!scheduler.online());
+  // 10, 20, 40 s apart: the first attempt and two retries, not one per tick
+  CHECK_EQ(client.connects, 3UL);
+  CHECK(scheduler.nextPoll() > 0);
+
+  client.failConnects = 0;
+  run(scheduler, OPSCHED_MAX_BACKOFF);
+  CHECK(scheduler.online());
+}
+
+TEST(backoffIsCapped) {
+  OctoprintApi &octoprint = api();
+  OctoprintScheduler scheduler(octoprint);
+  client.failConnects = 1000000;
+  run(scheduler, 30UL * 60 * 1000);
+  unsigned long before = client.connects;
+  run(scheduler, 3UL * OPSCHED_MAX_BACKOFF);
+  CHECK_EQ(client.connects - before, 3UL);
+  CHECK(scheduler.nextPoll() <= OPSCHED_MAX_BACKOFF);
+}
+
+// While the application has a request of its own running the scheduler only waits for it, that is no failure.
+TEST(busyIsNotAFailure) {
+  OctoprintApi &octoprint = api();
+  OctoprintScheduler scheduler(octoprint);
+  client.silent = true;
+  CHECK(octoprint.beginSendPostToOctoPrint("/api/printer/command", "{\"command\": \"G28\"}"));
+  scheduler.tick();
+  CHECK(scheduler.online());
+  CHECK_EQ(scheduler.nextPoll(), 0UL);
+  while (octoprint.poll())
+    ;
+}
+
+TEST(failedAnswersBackOff) {
+  OctoprintApi &octoprint = api();
+  OctoprintScheduler scheduler(octoprint);
+  client.route("/api/printer", httpResponse(500, "{}"));
+  run(scheduler, 60000);
+  CHECK(!scheduler.online());
+  CHECK_EQ(client.requests.size(), (size_t)3);
+}
@@ -0,0 +1,92 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// printerSnapshot and jobSnapshot, the String free versions of printerStats and printJob.
+#include "MockClient.h"
+#include "alloc.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  return instance;
+}
+
+TEST(printer) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer", httpResponse(200, recorded("printer.json")));
+  printerSnapshot printer;
+  CHECK(octoprint.getPrinterSnapshot(printer));
+  CHECK_EQ(printer.state, (uint8_t)OPAPI_STATE_PRINTING);
+  CHECK_EQ(printer.flags, (uint16_t)(OPAPI_FLAG_OPERATIONAL | OPAPI_FLAG_PRINTING | OPAPI_FLAG_SD_READY | OPAPI_FLAG_BED | OPAPI_FLAG_CHAMBER));
+  CHECK_EQ(printer.bedActual, (int16_t)598);
+  CHECK_EQ(printer.bedTarget, (int16_t)600);
+  CHECK_EQ(printer.chamberActual, (int16_t)314);
+  CHECK_EQ(printer.toolCount, (uint8_t)3);
+  CHECK_EQ(printer.toolActual[0], (int16_t)2147);
+  CHECK_EQ(printer.toolTarget[2], (int16_t)1950);
+}
+
+TEST(printerOffline) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer", httpResponse(409, "Printer is not operational", "Content-Type: text/html\r\n"));
+  printerSnapshot printer;
+  allocReset();
+  CHECK(octoprint.getPrinterSnapshot(printer));
+  CHECK_EQ(allocRead().allocations, (size_t)0);  // the error text is not copied into httpErrorBody
+  CHECK_EQ(printer.state, (uint8_t)OPAPI_STATE_OFFLINE);
+  CHECK_EQ(printer.flags, (uint16_t)0);
+}
+
+TEST(transferringToSd) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/printer", httpResponse(200, "{\"state\": {\"text\": \"Transferring file to SD\", \"flags\": {\"operational\": true, "
+                                                 "\"printing\": false, \"sdReady\": true}}, \"temperature\": {}}"));
+  printerSnapshot printer;
+  CHECK(octoprint.getPrinterSnapshot(printer));
+  CHECK_EQ(printer.state, (uint8_t)OPAPI_STATE_TRANSFERRING);
+  CHECK_EQ(printer.flags, (uint16_t)(OPAPI_FLAG_OPERATIONAL | OPAPI_FLAG_SD_READY));
+
+  client.route("/api/job", httpResponse(200, "{\"state\": \"Transferring file to SD\", \"job\": {}, \"progress\": {}}"));
+  jobSnapshot job;
+  CHECK(octoprint.getJobSnapshot(job));
+  CHECK_EQ(job.state, (uint8_t)OPAPI_STATE_TRANSFERRING);
+}
+
+TEST(job) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job.json")));
+  jobSnapshot job;
+  CHECK(octoprint.getJobSnapshot(job));
+  CHECK_EQ(job.state, (uint8_t)OPAPI_STATE_PRINTING);
+  CHECK_EQ(job.origin, (uint8_t)OPAPI_ORIGIN_LOCAL);
+  CHECK_EQ(job.estimate, (uint8_t)OPAPI_ESTIMATE_ESTIMATE);
+  CHECK_EQ(job.completion, (uint16_t)4237);
+  CHECK_EQ(job.fileSize, (uint32_t)4124833);
+  CHECK_EQ(job.filepos, (uint32_t)1747681);
+  CHECK_EQ(job.printTime, (uint32_t)3720);
+  CHECK_EQ(job.printTimeLeft, (int32_t)5104);
+  CHECK_EQ(job.estimatedPrintTime, (uint32_t)8811);
+  CHECK_EQ(std::string(job.filePath), std::string("parts/benchy.gcode"));
+}
+
+TEST(idleJob) {
+  OctoprintApi &octoprint = api();
+  client.route("/api/job", httpResponse(200, recorded("job_idle.json")));
+  jobSnapshot job;
+  CHECK(octoprint.getJobSnapshot(job));
+  CHECK_EQ(job.state, (uint8_t)OPAPI_STATE_OPERATIONAL);
+  CHECK_EQ(job.origin, (uint8_t)OPAPI_ORIGIN_UNKNOWN);
+  CHECK_EQ(job.printTimeLeft, (int32_t)-1);
+  CHECK_EQ(job.fileName[0], '\0');
+}
@@ -0,0 +1,156 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// octoPrintUploadFile(): a streamed multipart POST, built with OPAPI_METRICS to check the bytes it books.
+#include "MockClient.h"
+#include "OctoPrintAPI.h"
+#include "test.h"
+
+static MockClient client;
+
+enum { FILES = 2 };
+
+// size bytes of a pattern that does not repeat at any power of two, read like a file on an SD card.
+class PatternStream : public Stream {
+ public:
+  PatternStream(size_t size) : _size(size), _position(0) {}
+  static uint8_t at(size_t i) { return (uint8_t)(i * 31 + (i >> 9) * 7 + (i >> 17)); }
+  int available() { return _size - _position; }
+  int read() {
+    if (_position == _size) {
+      advanceMillis(1);  // an empty source, readBytes() waits out its timeout
+      return -1;
+    }
+    return at(_position++);
+  }
+  int peek() { return _position < _size ? at(_position) : -1; }
+  size_t write(uint8_t) { return 0; }
+
+ private:
+  size_t _size;
+  size_t _position;
+};
+
+static OctoprintApi &api() {
+  static OctoprintApi instance;
+  client.reset();
+  instance.init(client, IPAddress(10, 0, 0, 2), 80, "key");
+  instance.resetMetrics();
+  client.route("/api/files/local", httpResponse(201, "{\"done\": true}"));
+  return instance;
+}
+
+static bool matchesPattern(const std::string &data, size_t size) {
+  if (data.size() != size)
+    return false;
+  for (size_t i = 0; i < size; i++)
+    if ((uint8_t)data[i] != PatternStream::at(i))
+      return false;
+  return true;
+}
+
+// Bytes the whole request took on the wire.
+static size_t wireSize(const mockRequest &request) {
+  return request.method.size() + request.target.size() + strlen("  HTTP/1.1\r\n") + request.headers.size() + 2 + request.body.size();
+}
+
+static const std::string boundary = OPAPI_UPLOAD_BOUNDARY;
+
+struct multipart {
+  std::string head;
+  std::string data;
+  std::string tail;
+};
+
+static multipart split(const std::string &body, size_t size) {
+  multipart parts;
+  size_t start = body.find("\r\n\r\n") + 4;
+  parts.head   = body.substr(0, start);
+  parts.data   = body.substr(start, size);
+  parts.tail   = body.substr(start + size);
+  return parts;
+}
+
+static unsigned long lastProgress;
+static void progress(OctoprintApi *, unsigned long sent, unsigned long) { lastProgress = sent; }
+
+TEST(bodyArrivesByteForByte) {
+  OctoprintApi &octoprint = api();
+  const size_t size       = 5 * 1024 * 1024;
+  PatternStream source(size);
+  lastProgress = 0;
+  CHECK(octoprint.octoPrintUploadFile("models/benchy.gcode", source, size, progress));
+  CHECK_EQ(octoprint.httpStatusCode, 201);
+  CHECK_EQ(lastProgress, (unsigned long)size);
+  CHECK_EQ(client.requests.size(), (size_t)1);
+
+  const mockRequest &request = client.requests[0];
+  CHECK_EQ(request.method, std::string("POST"));
+  CHECK_EQ(request.header("Content-Type"), "multipart/form-data; boundary=" + boundary);
+  CHECK_EQ(request.header("Content-Length"), std::to_string(request.body.size()));
+  multipart parts = split(request.body, size);
+  CHECK(parts.head.find("--" + boundary + "\r\n") == 0);
+  CHECK(parts.head.find("filename=\"benchy.gcode\"") != std::string::npos);
+  CHECK(matchesPattern(parts.data, size));
+  CHECK(parts.tail.find("name=\"path\"\r\n\r\nmodels\r\n") != std::string::npos);
+  CHECK(parts.tail.rfind("--" + boundary + "--\r\n") == parts.tail.size() - boundary.size() - 6);
+  CHECK_EQ((size_t)octoprint.metrics.endpoints[FILES].bytesOut, wireSize(request));
+}
+
+TEST(partialWritesAreHandled) {
+  OctoprintApi &octoprint = api();
+  const size_t size       = 20000;
+  PatternStream source(size);
+  client.writeLimit = 100;
+  client.zeroWrites = 3;
+  CHECK(octoprint.octoPrintUploadFile("benchy.gcode", source, size));
+  client.writeLimit = 0;
+  CHECK_EQ(client.requests.size(), (size_t)1);
+  CHECK_EQ(client.requests[0].header("Content-Length"), std::to_string(client.requests[0].body.size()));
+  CHECK(matchesPattern(split(client.requests[0].body, size).data, size));
+  CHECK(client.writes > size / 100);
+}
+
+// Reference request for the failures below: the same upload of 1000 bytes, complete.
+static mockRequest complete() {
+  OctoprintApi &octoprint = api();
+  PatternStream source(1000);
+  octoprint.octoPrintUploadFile("benchy.gcode", source, 1000);
+  return client.requests[0];
+}
+
+TEST(sourceRunningDryFails) {
+  mockRequest reference   = complete();
+  OctoprintApi &octoprint = api();
+  PatternStream source(1000);
+  CHECK(!octoprint.octoPrintUploadFile("benchy.gcode", source, 1001));
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK(client.requests.empty());  // the server never saw a whole body
+  CHECK_EQ(client.stops, 1UL);
+  CHECK_EQ(octoprint.metrics.endpoints[FILES].requests, 1U);
+  // only what went out: everything but the tail
+  CHECK_EQ((size_t)octoprint.metrics.endpoints[FILES].bytesOut, wireSize(reference) - split(reference.body, 1000).tail.size());
+}
+
+static void dropAtTheEnd(OctoprintApi *, unsigned long sent, unsigned long size) {
+  if (sent == size)
+    client.dropConnection();
+}
+
+TEST(tailWriteFailureFails) {
+  mockRequest reference   = complete();
+  OctoprintApi &octoprint = api();
+  PatternStream source(1000);
+  unsigned long before = millis();
+  CHECK(!octoprint.octoPrintUploadFile("benchy.gcode", source, 1000, dropAtTheEnd));
+  CHECK_EQ(octoprint.httpStatusCode, -1);
+  CHECK(client.requests.empty());
+  CHECK(millis() - before < OPAPI_TIMEOUT);  // no waiting for an answer to a truncated body
+  CHECK_EQ((size_t)octoprint.metrics.endpoints[FILES].bytesOut, wireSize(reference) - split(reference.body, 1000).tail.size());
+}
@@ -0,0 +1,175 @@
+/* ___       _        ____       _       _      _    ____ ___
+  / _ \  ___| |_ ___ |  _ \ _ __(_)_ __ | |_   / \  |  _ \_ _|
+ | | | |/ __| __/ _ \| |_) | '__| | '_ \| __| / _ \ | |_) | |
+ | |_| | (__| || (_) |  __/| |  | | | | | |_ / ___ \|  __/| |
+  \___/ \___|\__\___/|_|   |_|  |_|_| |_|\__/_/   \_\_|  |___|
+.......By Stephen Ludgate https://www.chunkymedia.co.uk.......
+
+*/
+
+// OctoprintWorker on std::thread: readers on other threads must never see a snapshot that is half old, half new.
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "MockClient.h"
+#include "OctoprintWorker.h"
+#include "test.h"
+
+static MockClient client;
+static std::atomic<unsigned> served(0);
+
+// Every answer carries one number n everywhere: bed n, tool0 n + 100, completion n and printTime n.
+static std::string printer(unsigned n) {
+  char body[256];
+  snprintf(body, sizeof(body),
+           "{\"state\": {\"text\": \"Printing\", \"flags\": {\"operational\": true, \"printing\": true}}, \"temperature\": "
+           "{\"bed\": {\"actual\": %u, \"target\": 60}, \"tool0\": {\"actual\": %u, \"target\": 215}}}",
+           n, n + 100);
+  return httpResponse(200, body);
+}
+
+static std::string job(unsigned n) {
+  char body[256];
+  snprintf(body, sizeof(body),
+           "{\"state\": \"Printing\", \"job\": {\"file\": {\"name\": \"n%u.gcode\", \"size\": %u}}, \"progress\": "
+           "{\"completion\": %u, \"printTime\": %u, \"printTimeLeft\": 100}}",
+           n, n, n, n);
+  return httpResponse(200, body);
+}
+
+static std::string answer(const mockRequest &request) {
+  if (request.method == "POST")
+    return httpResponse(204, "");
+  // The printer/job pair of one refresh share their number, so a consistent snapshot has the same n everywhere.
+  unsigned n = served++ / 2;
+  return request.target == "/api/printer" ? printer(n % 90) : job(n % 90);
+}
+
+static bool consistent(const printerSnapshot &p, const jobSnapshot &j) {
+  unsigned n = p.bedActual / 10;
+  char name[16];
+  snprintf(name, sizeof(name), "n%u.gcode", n);
+  return p.toolActual[0] == (int16_t)((n + 100) * 10) && j.completion == n * 100 && j.printTime == n && j.fileSize == n &&
+         strcmp(j.fileName, name) == 0;
+}
+
+TEST(readersNeverSeeTornSnapshots) {
+  client.reset();
+  client.handler = answer;
+  OctoprintApi api(client, IPAddress(10, 0, 0, 2), 80, "key");
+  api.setKeepAlive(true);
+  OctoprintWorker worker(api);
+  CHECK(worker.begin(0));
+
+  std::atomic<bool> stop(false);
+  std::atomic<unsigned long> reads(0);
+  std::atomic<unsigned long> torn(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; i++) {
+    readers.push_back(std::thread([&] {
+      printerSnapshot p;
+      jobSnapshot j;
+      while (!stop) {
+        if (worker.read(p, j)) {
+          reads++;
+          if (!consistent(p, j))
+            torn++;
+        }
+      }
+    }));
+  }
+
+  // Meanwhile other threads queue commands, some of which may find the queue full.
+  std::atomic<unsigned> queued(0);
+  std::thread sender([&] {
+    for (int i = 0; i < 200; i++) {
+      if (worker.send(i % 2 ? OPWORKER_GCODE : OPWORKER_JOB_PAUSE, "M117 hi"))
+        queued++;
+      std::this_thread::yield();
+    }
+  });
+
+  while (worker.updates() < 2000)
+    std::this_thread::yield();
+  sender.join();
+  stop = true;
+  for (std::thread &reader : readers)
+    reader.join();
+  worker.end();
+
+  printf("  %u updates, %lu reads, %u commands queued\n", worker.updates(), reads.load(), queued.load());
+  CHECK_EQ(torn.load(), 0UL);
+  CHECK(reads > 0);
+  CHECK(worker.online());
+  size_t posts = 0;
+  for (const mockRequest &request : client.requests)
+    posts += request.method == "POST";
+  CHECK(posts <= queued);
+  CHECK(posts > 0);
+}
+
+TEST(offlineKeepsTheLastSnapshot) {
+  client.reset();
+  client.handler = answer;
+  served         = 0;
+  OctoprintApi api(client, IPAddress(10, 0, 0, 2), 80, "key");
+  OctoprintWorker worker(api);
+  printerSnapshot p;
+  jobSnapshot j;
+  CHECK(!worker.read(p, j));
+  CHECK(worker.begin(50));
+  while (worker.updates() < 1)
+    std::this_thread::yield();
+  client.failConnects = 1000000;
+  CHECK(worker.refresh());
+  while (worker.online())
+    std::this_thread::yield();
+  CHECK(worker.read(p, j));
+  CHECK(consistent(p, j));
+  worker.end();
+}
+
+TEST(endStopsPromptly) {
+  client.reset();
+  client.handler = answer;
+  OctoprintApi api(client, IPAddress(10, 0, 0, 2), 80, "key");
+  OctoprintWorker worker(api);
+  CHECK(worker.begin(60000));
+  for (int i = 0; i < OPWORKER_QUEUE_LENGTH * 2; i++)
+    worker.send(OPWORKER_GCODE, "G4 P0");  // fill the queue, end() must still get through
+  worker.end();
+  CHECK(worker.begin(60000));  // and it can be started again
+  worker.end();
+}
+
+// Other threads keep sending while end() runs: it must still stop the worker, and nothing they queued survives it.
+TEST(endWhileOthersSend) {
+  client.reset();
+  client.handler = answer;
+  OctoprintApi api(client, IPAddress(10, 0, 0, 2), 80, "key");
+  OctoprintWorker worker(api);
+  CHECK(worker.begin(60000));
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> senders;
+  for (int i = 0; i < 3; i++)
+    senders.emplace_back([&] {
+      while (!stop)
+        worker.send(OPWORKER_GCODE, "G4 P0");
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  worker.end();
+  size_t before = client.requests.size();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  stop = true;
+  for (std::thread &sender : senders)
+    sender.join();
+
+  CHECK(worker.begin(60000));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  worker.end();
+  size_t posts = 0;
+  for (size_t i = before; i < client.requests.size(); i++)
+    posts += client.requests[i].method == "POST";
+  CHECK_EQ(posts, (size_t)0);
+}